@@ -0,0 +1,240 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "perf.h"
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PERF_TSC 1
+#endif
+
+const char *const perf_event_names[PERF_EVENTS] = {
+    "cycles", "instructions", "l1d_misses", "llc_misses", "dtlb_misses"
+};
+
+// Калибровка: столько TSC уходит на интервал CLOCK_MONOTONIC
+#define CALIBRATE_NS 20000000
+
+static double monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+uint64_t perf_tsc_begin(void)
+{
+#ifdef PERF_TSC
+    _mm_lfence();
+    uint64_t t = __rdtsc();
+    _mm_lfence();
+    return t;
+#else
+    return (uint64_t)monotonic_ns();
+#endif
+}
+
+uint64_t perf_tsc_end(void)
+{
+#ifdef PERF_TSC
+    unsigned aux;
+    uint64_t t = __rdtscp(&aux);
+    _mm_lfence();
+    return t;
+#else
+    return (uint64_t)monotonic_ns();
+#endif
+}
+
+double perf_tsc_hz(void)
+{
+    static double hz;
+
+    if (hz == 0) {
+#ifdef PERF_TSC
+        double t0 = monotonic_ns();
+        uint64_t c0 = perf_tsc_begin();
+        while (monotonic_ns() - t0 < CALIBRATE_NS)
+            ;
+        uint64_t c1 = perf_tsc_end();
+        double t1 = monotonic_ns();
+        hz = (double)(c1 - c0) / (t1 - t0) * 1e9;
+#else
+        hz = 1e9;
+#endif
+    }
+    return hz;
+}
+
+double perf_tsc_seconds(uint64_t ticks)
+{
+    return (double)ticks / perf_tsc_hz();
+}
+
+#ifdef __linux__
+static int open_event(enum perf_event_id id)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    switch (id) {
+    case PERF_CYCLES:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+    case PERF_INSTRUCTIONS:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case PERF_L1D_MISSES:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        break;
+    case PERF_LLC_MISSES:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        break;
+    case PERF_DTLB_MISSES:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        break;
+    default:
+        return -1;
+    }
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// Значение, приведённое ко всему времени: при мультиплексировании
+// событие считалось только часть интервала
+static int read_event(int fd, uint64_t *value)
+{
+    uint64_t v[3];
+    if (read(fd, v, sizeof(v)) != sizeof(v) || v[2] == 0)
+        return 0;
+    *value = v[2] < v[1] ? (uint64_t)((double)v[0] * v[1] / v[2]) : v[0];
+    return 1;
+}
+#endif
+
+void perf_open(struct perf_region *r)
+{
+    // Уже открыт: нулевой fd у счётчика не бывает — это stdin
+    if (r->fd[0] != 0)
+        return;
+    for (int e = 0; e < PERF_EVENTS; ++e) {
+#ifdef __linux__
+        r->fd[e] = open_event((enum perf_event_id)e);
+#else
+        r->fd[e] = -1;
+#endif
+    }
+    perf_tsc_hz();
+}
+
+void perf_begin(struct perf_region *r)
+{
+    perf_open(r);
+#ifdef __linux__
+    for (int e = 0; e < PERF_EVENTS; ++e) {
+        if (r->fd[e] < 0)
+            continue;
+        ioctl(r->fd[e], PERF_EVENT_IOC_ENABLE, 0);
+        if (!read_event(r->fd[e], &r->start[e]))
+            r->start[e] = 0;
+    }
+#endif
+    r->tsc = perf_tsc_begin();
+}
+
+void perf_end(struct perf_region *r, struct perf_sample *s)
+{
+    uint64_t tsc = perf_tsc_end();
+
+    memset(s, 0, sizeof(*s));
+    s->seconds = perf_tsc_seconds(tsc - r->tsc);
+#ifdef __linux__
+    for (int e = 0; e < PERF_EVENTS; ++e) {
+        uint64_t v;
+        if (r->fd[e] < 0)
+            continue;
+        if (read_event(r->fd[e], &v)) {
+            s->valid[e] = 1;
+            s->value[e] = (double)(v - r->start[e]);
+        }
+        ioctl(r->fd[e], PERF_EVENT_IOC_DISABLE, 0);
+    }
+#endif
+}
+
+void perf_close(struct perf_region *r)
+{
+    for (int e = 0; e < PERF_EVENTS; ++e) {
+        if (r->fd[e] > 0)
+            close(r->fd[e]);
+        r->fd[e] = 0;
+    }
+}
+
+void perf_accumulate(struct perf_sample *sum, const struct perf_sample *s)
+{
+    sum->seconds += s->seconds;
+    for (int e = 0; e < PERF_EVENTS; ++e) {
+        sum->valid[e] = s->valid[e];
+        sum->value[e] += s->value[e];
+    }
+}
+
+double perf_ipc(const struct perf_sample *s)
+{
+    if (!s->valid[PERF_CYCLES] || !s->valid[PERF_INSTRUCTIONS] || s->value[PERF_CYCLES] == 0)
+        return NAN;
+    return s->value[PERF_INSTRUCTIONS] / s->value[PERF_CYCLES];
+}
+
+double perf_mpki(const struct perf_sample *s, enum perf_event_id miss)
+{
+    if (!s->valid[miss] || !s->valid[PERF_INSTRUCTIONS] || s->value[PERF_INSTRUCTIONS] == 0)
+        return NAN;
+    return s->value[miss] * 1000.0 / s->value[PERF_INSTRUCTIONS];
+}
+
+void perf_print(FILE *f, const char *label, const struct perf_sample *s)
+{
+    fprintf(f, "%s: %.6f s", label, s->seconds);
+    if (!isnan(perf_ipc(s)))
+        fprintf(f, ", IPC %.2f", perf_ipc(s));
+    if (s->valid[PERF_INSTRUCTIONS]) {
+        static const char *const short_names[PERF_EVENTS] = { "", "", "L1d", "LLC", "dTLB" };
+        int first = 1;
+        for (int e = PERF_L1D_MISSES; e < PERF_EVENTS; ++e) {
+            if (!s->valid[e])
+                continue;
+            fprintf(f, "%s %s %.2f", first ? "," : "", short_names[e],
+                    perf_mpki(s, (enum perf_event_id)e));
+            first = 0;
+        }
+        if (!first)
+            fprintf(f, " MPKI");
+    }
+    if (!s->valid[PERF_CYCLES] && !s->valid[PERF_INSTRUCTIONS])
+        fprintf(f, " (no hardware counters)");
+    fprintf(f, "\n");
+}
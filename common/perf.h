@@ -0,0 +1,77 @@
+#ifndef COMMON_PERF_H
+#define COMMON_PERF_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Общие замеры для всех лабораторных: таймер по TSC и аппаратные счётчики.
+//
+// Таймер: perf_tsc_begin ставит lfence до и после rdtsc, perf_tsc_end —
+// rdtscp и lfence, так что в интервал не попадают команды снаружи и не
+// выпадают изнутри. TSC тикает с постоянной (номинальной) частотой, а не
+// с частотой ядра; частота калибруется по CLOCK_MONOTONIC один раз.
+// Вне x86 вместо TSC — CLOCK_MONOTONIC в наносекундах.
+uint64_t perf_tsc_begin(void);
+uint64_t perf_tsc_end(void);
+// Тиков TSC в секунду
+double perf_tsc_hz(void);
+double perf_tsc_seconds(uint64_t ticks);
+
+// Счётчики perf_event_open вызывающего потока. Каждое событие открывается
+// отдельно: чего нет (виртуальная машина, perf_event_paranoid, другой
+// процессор), то просто не считается. Потоки OpenMP не учитываются —
+// для параллельных участков IPC и промахи относятся к главному потоку.
+enum perf_event_id {
+    PERF_CYCLES,            // такты ядра
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,        // промахи чтения L1d
+    PERF_LLC_MISSES,
+    PERF_DTLB_MISSES,       // промахи чтения dTLB
+    PERF_EVENTS
+};
+
+extern const char *const perf_event_names[PERF_EVENTS];
+
+struct perf_region {
+    int fd[PERF_EVENTS];
+    uint64_t start[PERF_EVENTS];
+    uint64_t tsc;
+};
+
+struct perf_sample {
+    double seconds;
+    int valid[PERF_EVENTS];
+    double value[PERF_EVENTS];      // с поправкой на мультиплексирование
+};
+
+// Перед первым perf_begin структура обнуляется: struct perf_region r = {0}.
+// perf_open открывает счётчики (или не открывает — замер времени работает
+// и без них) и калибрует TSC; это десятки миллисекунд, поэтому его стоит
+// вызвать до запуска внешних таймеров. Иначе его вызовет первый perf_begin.
+void perf_open(struct perf_region *r);
+// Запускает участок. Один perf_region можно запускать много раз.
+void perf_begin(struct perf_region *r);
+// Останавливает участок; счётчики остаются открытыми до perf_close
+void perf_end(struct perf_region *r, struct perf_sample *s);
+void perf_close(struct perf_region *r);
+
+// Складывает замеры в *sum (для участков, пройденных много раз)
+void perf_accumulate(struct perf_sample *sum, const struct perf_sample *s);
+
+// Производные метрики; NAN, если нужных счётчиков нет
+double perf_ipc(const struct perf_sample *s);
+// Промахов на тысячу команд
+double perf_mpki(const struct perf_sample *s, enum perf_event_id miss);
+
+// "label: 1.234567 s, IPC 2.10, L1d 3.1, LLC 0.2, dTLB 0.0 MPKI"
+void perf_print(FILE *f, const char *label, const struct perf_sample *s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,232 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "sort.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#else
+static int omp_get_max_threads(void) { return 1; }
+static int omp_get_thread_num(void) { return 0; }
+#endif
+
+// Короче — сортировка вставками: на гистограммы уйдёт больше
+#define SORT_INSERTION 64
+// Подсчётом, если диапазон ключей не больше стольких значений
+// или не больше n: массив счётчиков тогда не длиннее входа
+#define SORT_COUNTING_RANGE (1 << 16)
+// С 11-битными цифрами три прохода вместо четырёх, но 2048 счётчиков на
+// разряд окупаются только на больших массивах
+#define SORT_WIDE_DIGITS (1 << 20)
+// Насколько вперёд подтягивать строку, куда ляжет элемент
+#define SORT_PREFETCH 16
+// Меньше — в один поток
+#define SORT_PARALLEL (1 << 16)
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PREFETCH_WRITE(p) __builtin_prefetch((p), 1)
+#else
+#define PREFETCH_WRITE(p) ((void)(p))
+#endif
+
+static void insertion_sort(int *arr, size_t n)
+{
+    for (size_t i = 1; i < n; ++i) {
+        int v = arr[i];
+        size_t j = i;
+        for (; j > 0 && arr[j - 1] > v; --j)
+            arr[j] = arr[j - 1];
+        arr[j] = v;
+    }
+}
+
+static int compare_int(const void *a, const void *b)
+{
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+// Потоков по умолчанию; 0 — сколько даёт OpenMP
+static int sort_threads;
+
+void sort_set_threads(int threads)
+{
+    sort_threads = threads > 0 ? threads : 0;
+}
+
+// Кусок [lo, hi) потока tid из threads: равные доли входа
+static void chunk(size_t n, int tid, int threads, size_t *lo, size_t *hi)
+{
+    *lo = n / threads * tid + (n % threads < (size_t)tid ? n % threads : (size_t)tid);
+    *hi = *lo + n / threads + ((size_t)tid < n % threads);
+}
+
+static int counting_sort(int *arr, size_t n, int min, size_t range, int threads)
+{
+    // Свои счётчики у каждого потока: общие пришлось бы менять атомарно
+    size_t *count = calloc(range * threads, sizeof(size_t));
+    size_t *start = malloc(range * sizeof(size_t));
+    if (!count || !start) {
+        free(count);
+        free(start);
+        return 0;
+    }
+
+    #pragma omp parallel num_threads(threads)
+    {
+        int tid = omp_get_thread_num();
+        size_t lo, hi, *own = count + range * tid;
+        chunk(n, tid, threads, &lo, &hi);
+        for (size_t i = lo; i < hi; ++i)
+            ++own[(size_t)((int64_t)arr[i] - min)];
+    }
+
+    size_t sum = 0;
+    for (size_t v = 0; v < range; ++v) {
+        start[v] = sum;
+        for (int t = 0; t < threads; ++t)
+            sum += count[range * t + v];
+    }
+
+    // Значения раздаются потокам порциями: на малом диапазоне у одного
+    // значения могут быть миллионы повторов
+    #pragma omp parallel for num_threads(threads) schedule(dynamic, 64)
+    for (size_t v = 0; v < range; ++v) {
+        size_t end = v + 1 < range ? start[v + 1] : n;
+        for (size_t k = start[v]; k < end; ++k)
+            arr[k] = (int)((int64_t)min + (int64_t)v);
+    }
+
+    free(count);
+    free(start);
+    return 1;
+}
+
+// Ключ без знака с тем же порядком, что у int
+static inline uint32_t key(int v)
+{
+    return (uint32_t)v ^ 0x80000000u;
+}
+
+// Поразрядная сортировка: на каждом проходе поток строит гистограмму
+// своего куска, смещения раздаются по (цифра, поток), и потоки
+// раскладывают свои куски независимо. Порядок потоков внутри цифры
+// совпадает с порядком кусков, поэтому проход устойчив, как и в один
+// поток. Гистограммы всех разрядов сразу, как бывало в один поток,
+// здесь не годятся: после прохода в куске потока уже другие ключи.
+static int radix_sort(int *arr, size_t n, int threads)
+{
+    const int bits = n >= SORT_WIDE_DIGITS ? 11 : 8;
+    const int passes = (32 + bits - 1) / bits;
+    const uint32_t mask = (1u << bits) - 1;
+    const size_t buckets = (size_t)1 << bits;
+    // count[tid * buckets + d]
+    size_t *count = malloc((size_t)threads * buckets * sizeof(size_t));
+    int *tmp = malloc(n * sizeof(int));
+    int *src = arr, *dst = tmp;
+    int skip = 0;
+
+    if (!count || !tmp) {
+        free(count);
+        free(tmp);
+        return 0;
+    }
+
+    #pragma omp parallel num_threads(threads)
+    {
+        int tid = omp_get_thread_num();
+        size_t lo, hi, *offset = count + (size_t)tid * buckets;
+        chunk(n, tid, threads, &lo, &hi);
+
+        for (int p = 0; p < passes; ++p) {
+            int shift = p * bits;
+
+            memset(offset, 0, buckets * sizeof(size_t));
+            for (size_t i = lo; i < hi; ++i)
+                ++offset[(key(src[i]) >> shift) & mask];
+            #pragma omp barrier
+
+            #pragma omp single
+            {
+                // Все ключи с одной цифрой — проход ничего не переставит
+                size_t sum = 0, same = 0;
+                uint32_t d0 = (key(src[0]) >> shift) & mask;
+                for (int t = 0; t < threads; ++t)
+                    same += count[(size_t)t * buckets + d0];
+                skip = same == n;
+
+                for (size_t d = 0; !skip && d < buckets; ++d)
+                    for (int t = 0; t < threads; ++t) {
+                        size_t v = count[(size_t)t * buckets + d];
+                        count[(size_t)t * buckets + d] = sum;
+                        sum += v;
+                    }
+            }
+
+            if (!skip) {
+                // Разброс по корзинам: место элемента, идущего на
+                // SORT_PREFETCH позже, подтягивается в кэш заранее
+                size_t i = lo;
+                for (; i + SORT_PREFETCH < hi; ++i) {
+                    uint32_t ahead = (key(src[i + SORT_PREFETCH]) >> shift) & mask;
+                    PREFETCH_WRITE(dst + offset[ahead]);
+                    dst[offset[(key(src[i]) >> shift) & mask]++] = src[i];
+                }
+                for (; i < hi; ++i)
+                    dst[offset[(key(src[i]) >> shift) & mask]++] = src[i];
+            }
+            #pragma omp barrier
+
+            #pragma omp single
+            if (!skip) {
+                int *t = src;
+                src = dst;
+                dst = t;
+            }
+        }
+    }
+
+    if (src != arr)
+        memcpy(arr, src, n * sizeof(int));
+    free(count);
+    free(tmp);
+    return 1;
+}
+
+void sort_ints(int *arr, size_t n)
+{
+    int threads = sort_threads ? sort_threads : omp_get_max_threads();
+
+    if (n < SORT_INSERTION) {
+        insertion_sort(arr, n);
+        return;
+    }
+    // На небольших массивах запуск потоков дороже самой сортировки
+    if (n < SORT_PARALLEL)
+        threads = 1;
+
+    int min = arr[0], max = arr[0];
+    #pragma omp parallel for num_threads(threads) reduction(min:min) reduction(max:max)
+    for (size_t i = 1; i < n; ++i) {
+        if (arr[i] < min) min = arr[i];
+        if (arr[i] > max) max = arr[i];
+    }
+
+    // Счётчики на всё range у каждого потока — только для малого диапазона
+    size_t range = (size_t)((int64_t)max - min) + 1;
+    if ((range <= SORT_COUNTING_RANGE || (threads == 1 && range <= n)) &&
+        counting_sort(arr, n, min, range, threads))
+        return;
+    if (radix_sort(arr, n, threads))
+        return;
+    qsort(arr, n, sizeof(int), compare_int);
+}
+
+int sort_is_sorted(const int *arr, size_t n)
+{
+    for (size_t i = 1; i < n; ++i)
+        if (arr[i - 1] > arr[i])
+            return 0;
+    return 1;
+}
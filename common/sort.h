@@ -0,0 +1,31 @@
+#ifndef COMMON_SORT_H
+#define COMMON_SORT_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Сортировка целых по возрастанию за O(n): сортировка подсчётом, если
+// ключи укладываются в небольшой диапазон, иначе поразрядная LSD по
+// 8-битным (для небольших n) или 11-битным цифрам. Разряды, одинаковые
+// у всех ключей, пропускаются. Нужен временный буфер на n чисел; если
+// памяти нет — qsort.
+//
+// С OpenMP сортирует в sort_set_threads потоков (по умолчанию — сколько
+// даёт omp_get_max_threads): у каждого потока свои гистограммы, и свой
+// кусок он раскладывает сам. Результат от числа потоков не зависит.
+void sort_ints(int *arr, size_t n);
+
+// Число потоков sort_ints; 0 — по умолчанию
+void sort_set_threads(int threads);
+
+// Отсортирован ли массив
+int sort_is_sorted(const int *arr, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
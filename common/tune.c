@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "tune.h"
+
+void tune_host(char *out, size_t size)
+{
+    char line[512], model[256] = "unknown";
+    FILE *f = fopen("/proc/cpuinfo", "r");
+
+    while (f && fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "model name", 10) == 0) {
+            char *colon = strchr(line, ':');
+            if (colon) {
+                snprintf(model, sizeof(model), "%s", colon + 2);
+                model[strcspn(model, "\n")] = '\0';
+            }
+            break;
+        }
+    }
+    if (f) fclose(f);
+
+    snprintf(out, size, "%s, %ld cpus", model, sysconf(_SC_NPROCESSORS_ONLN));
+}
+
+static void cache_path(char *out, size_t size)
+{
+    const char *env = getenv("LAB_TUNE_CACHE");
+    const char *home = getenv("HOME");
+    char node[256];
+
+    if (env && *env) {
+        snprintf(out, size, "%s", env);
+        return;
+    }
+    if (gethostname(node, sizeof(node)) != 0)
+        snprintf(node, sizeof(node), "localhost");
+    node[sizeof(node) - 1] = '\0';
+
+    if (home && *home) {
+        char dir[4096];
+        snprintf(dir, sizeof(dir), "%s/.cache", home);
+        mkdir(dir, 0755);
+        if (snprintf(out, size, "%s/lab-tune-%s.conf", dir, node) < (int)size)
+            return;
+    }
+    snprintf(out, size, "lab-tune.conf");
+}
+
+int tune_load(struct tune_cache *cache)
+{
+    char line[512];
+
+    cache->count = 0;
+    cache_path(cache->path, sizeof(cache->path));
+    tune_host(cache->host, sizeof(cache->host));
+
+    FILE *f = fopen(cache->path, "r");
+    if (!f)
+        return 0;
+
+    // "# host: <отпечаток>"
+    int same_host = fgets(line, sizeof(line), f) && strncmp(line, "# host: ", 8) == 0 &&
+                    strncmp(line + 8, cache->host, strlen(cache->host)) == 0 &&
+                    line[8 + strlen(cache->host)] == '\n';
+
+    while (same_host && fgets(line, sizeof(line), f)) {
+        char key[TUNE_KEY_SIZE];
+        long value;
+        if (line[0] != '#' && sscanf(line, "%63s = %ld", key, &value) == 2)
+            tune_set(cache, key, value);
+    }
+
+    fclose(f);
+    return same_host;
+}
+
+int tune_get(const struct tune_cache *cache, const char *key, long *value)
+{
+    for (size_t i = 0; i < cache->count; ++i)
+        if (strcmp(cache->entries[i].key, key) == 0) {
+            *value = cache->entries[i].value;
+            return 1;
+        }
+    return 0;
+}
+
+void tune_set(struct tune_cache *cache, const char *key, long value)
+{
+    size_t i = 0;
+    while (i < cache->count && strcmp(cache->entries[i].key, key) != 0)
+        ++i;
+    if (i == TUNE_MAX_ENTRIES)
+        return;
+
+    snprintf(cache->entries[i].key, TUNE_KEY_SIZE, "%s", key);
+    cache->entries[i].value = value;
+    if (i == cache->count)
+        ++cache->count;
+}
+
+int tune_save(const struct tune_cache *cache)
+{
+    // Запись во временный файл и rename: параллельно запущенные
+    // программы не увидят файл наполовину записанным
+    char temp[4200];
+    snprintf(temp, sizeof(temp), "%s.%d", cache->path, (int)getpid());
+
+    FILE *f = fopen(temp, "w");
+    if (!f)
+        return 0;
+
+    fprintf(f, "# host: %s\n", cache->host);
+    for (size_t i = 0; i < cache->count; ++i)
+        fprintf(f, "%s = %ld\n", cache->entries[i].key, cache->entries[i].value);
+
+    int ok = fclose(f) == 0 && rename(temp, cache->path) == 0;
+    if (!ok)
+        unlink(temp);
+    return ok;
+}
@@ -0,0 +1,43 @@
+#ifndef COMMON_TUNE_H
+#define COMMON_TUNE_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Кэш автотюнера: текстовый файл со строками "ключ = число", свой для
+// каждой машины. Путь — $LAB_TUNE_CACHE, иначе
+// ~/.cache/lab-tune-<имя узла>.conf, иначе ./lab-tune.conf.
+// Первая строка — отпечаток процессора (модель и число ядер): файл,
+// записанный на другом железе, не читается и при сохранении перезаписывается.
+#define TUNE_MAX_ENTRIES 128
+#define TUNE_KEY_SIZE 64
+
+struct tune_entry {
+    char key[TUNE_KEY_SIZE];
+    long value;
+};
+
+struct tune_cache {
+    char path[4096];
+    char host[256];
+    size_t count;
+    struct tune_entry entries[TUNE_MAX_ENTRIES];
+};
+
+// Возвращает 0, если файла нет или он от другой машины (кэш тогда пуст)
+int tune_load(struct tune_cache *cache);
+int tune_get(const struct tune_cache *cache, const char *key, long *value);
+void tune_set(struct tune_cache *cache, const char *key, long value);
+int tune_save(const struct tune_cache *cache);
+
+// Отпечаток машины: модель процессора и число ядер
+void tune_host(char *out, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
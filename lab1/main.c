@@ -1,11 +1,21 @@
+// Сборка: gcc -O2 -fopenmp main.c ../common/perf.c ../common/sort.c -o main -lm
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
+#include <limits.h>
 #include <time.h>
+#include <unistd.h>
 
-void addDigitsToArray(size_t n, int *arr) {
+#include "../common/perf.h"
+#include "../common/sort.h"
+
+// Числа из [0, range); range = 0 — весь диапазон int
+void addDigitsToArray(size_t n, int *arr, unsigned long range) {
   for (size_t i = 0; i < n; ++i) {
-    arr[i] = rand() % 100;
+    // rand() даёт только 31 бит: для всего диапазона склеиваются два
+    unsigned long r = ((unsigned long)rand() << 31) ^ (unsigned long)rand();
+    arr[i] = range ? (int)(r % range) : (int)(unsigned int)r;
   }
 }
 
@@ -17,12 +27,12 @@ void swap(int* xp, int* yp)
 }
 
 // An optimized version of Bubble Sort
-void bubbleSort(int *arr, int n)
+void bubbleSort(int *arr, size_t n)
 {
-    int i, j;
+    size_t i, j;
     bool swapped;
 
-    for (i = 0; i < n - 1; i++) {
+    for (i = 0; i + 1 < n; i++) {
         swapped = false;
         for (j = 0; j < n - i - 1; j++) {
             if (arr[j] > arr[j + 1]) {
@@ -38,19 +48,101 @@ void bubbleSort(int *arr, int n)
     }
 }
 
+// Время sort_ints на копиях arr в 1, 2, 4, ... потоков и в max_threads
+// (0 — во все ядра); ускорение — относительно одного потока
+int scaling(const int *arr, size_t n, int max_threads) {
+  long cpus = max_threads > 0 ? max_threads : sysconf(_SC_NPROCESSORS_ONLN);
+  int *work = malloc(sizeof(int) * n);
+  double base = 0;
+
+  if (!work) {
+    fprintf(stderr, "Cannot allocate %zu numbers\n", n);
+    return 1;
+  }
+  if (cpus < 1)
+    cpus = 1;
+
+  printf("%8s %12s %10s %12s\n", "threads", "time, s", "speedup", "Mkeys/s");
+  for (long t = 1; t <= cpus; t = t < cpus && t * 2 > cpus ? cpus : t * 2) {
+    struct perf_region region = {0};
+    struct perf_sample sample;
+
+    memcpy(work, arr, sizeof(int) * n);
+    sort_set_threads((int)t);
+    perf_begin(&region);
+    sort_ints(work, n);
+    perf_end(&region, &sample);
+    perf_close(&region);
+
+    if (t == 1)
+      base = sample.seconds;
+    printf("%8ld %12.6f %10.2f %12.1f%s\n", t, sample.seconds, base / sample.seconds,
+           n / sample.seconds * 1e-6, sort_is_sorted(work, n) ? "" : "  (not sorted!)");
+    if (t == cpus)
+      break;
+  }
+
+  sort_set_threads(0);
+  free(work);
+  return 0;
+}
+
 int main(int argc, char *argv[]) {
-  struct timespec start, end;
+  struct perf_region region = {0};
+  struct perf_sample sample;
   srand(time(NULL));
 
-  size_t n = (size_t) (atoi(argv[1]));
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s N [range, 0 - any int] [bubble | scaling | threads=K]\n",
+            argv[0]);
+    return 1;
+  }
+  size_t n = (size_t) strtoull(argv[1], NULL, 10);
+  unsigned long range = argc > 2 ? strtoul(argv[2], NULL, 10) : 100;
+  // Ключи из [0, range) должны помещаться в int
+  if (range > (unsigned long)INT_MAX + 1) {
+    fprintf(stderr, "Range must not exceed %lu\n", (unsigned long)INT_MAX + 1);
+    return 1;
+  }
+  // Пузырёк оставлен для сравнения: на больших n он не закончится
+  bool bubble = false, scale = false;
+  int threads = 0;
+  for (int i = 3; i < argc; ++i) {
+    if (strcmp(argv[i], "bubble") == 0)
+      bubble = true;
+    else if (strcmp(argv[i], "scaling") == 0)
+      scale = true;
+    else if (strncmp(argv[i], "threads=", 8) == 0)
+      threads = atoi(argv[i] + 8);
+  }
   int *arr = malloc(sizeof(int) * n);
-  addDigitsToArray(n, arr);
+  if (!arr) {
+    fprintf(stderr, "Cannot allocate %zu numbers\n", n);
+    return 1;
+  }
+  addDigitsToArray(n, arr, range);
+  sort_set_threads(threads);
+
+  if (scale) {
+    int rc = scaling(arr, n, threads);
+    free(arr);
+    return rc;
+  }
 
-  clock_gettime(CLOCK_MONOTONIC_RAW, &start);
-  bubbleSort(arr, n);
-  clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+  perf_begin(&region);
+  if (bubble)
+    bubbleSort(arr, n);
+  else
+    sort_ints(arr, n);
+  perf_end(&region, &sample);
+  perf_close(&region);
 
-  printf("Time taken: %lf sec.\n", end.tv_sec-start.tv_sec + 0.000000001*(end.tv_nsec-start.tv_nsec));
+  printf("Time taken: %lf sec.\n", sample.seconds);
+  // sort_ints идёт в потоках OpenMP, а счётчики — только главного потока
+  perf_print(stdout, bubble ? "bubbleSort counters" : "sort_ints counters (main thread)",
+             &sample);
+  if (!sort_is_sorted(arr, n))
+    printf("Result is not sorted!\n");
 
   free(arr);
   return 0;
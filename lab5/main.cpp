@@ -1,9 +1,16 @@
+// Сборка: gcc -O2 -c ../common/perf.c && g++ -O2 main.cpp perf.o -o lab5 <флаги OpenCV>
 #include <iostream>
 #include <opencv2/highgui.hpp>
 #include <opencv2/videoio.hpp>
 #include <opencv2/opencv.hpp>
 #include <chrono>
 
+#include "../common/perf.h"
+
+// Длительности в миллисекундах с дробной частью: duration_cast к
+// milliseconds отбрасывал всё меньше миллисекунды у каждого кадра
+using Milliseconds = std::chrono::duration<double, std::milli>;
+
 void applyOverlay(const cv::Mat& src, cv::Mat& dst, const cv::Mat& overlay, const cv::Rect& region) {
     cv::Mat resizedOverlay;
     cv::resize(overlay, resizedOverlay, cv::Size(region.width, region.height));
@@ -67,6 +74,11 @@ int main() {
     auto startTime = std::chrono::high_resolution_clock::now();
     int frameCounter = 0;
     double fps = 0.0;
+    // Счётчики процессора на обработке кадров за интервал вывода
+    perf_region processingRegion = {};
+    perf_sample processingCounters = {};
+    // Открытие счётчиков и калибровка TSC — до первого кадра, а не в его время
+    perf_open(&processingRegion);
 
     while (true) {
         // Захват кадра
@@ -74,10 +86,11 @@ int main() {
         capture >> frame;
         if (frame.empty()) break;
         auto captureEnd = std::chrono::high_resolution_clock::now();
-        totalReadingTime += std::chrono::duration_cast<std::chrono::milliseconds>(captureEnd - captureStart).count();
+        totalReadingTime += Milliseconds(captureEnd - captureStart).count();
 
         // Обработка кадра
         auto processingStart = std::chrono::high_resolution_clock::now();
+        perf_begin(&processingRegion);
 
         // Конвертация в черно-белый формат
         cv::Mat grayFrame;
@@ -95,13 +108,16 @@ int main() {
         // Увеличение яркости
         cv::add(frame, cv::Scalar(70, 70, 70), frame);
 
+        perf_sample frameCounters;
+        perf_end(&processingRegion, &frameCounters);
+        perf_accumulate(&processingCounters, &frameCounters);
         auto processingEnd = std::chrono::high_resolution_clock::now();
-        totalProcessingTime += std::chrono::duration_cast<std::chrono::milliseconds>(processingEnd - processingStart).count();
+        totalProcessingTime += Milliseconds(processingEnd - processingStart).count();
 
         // FPS
         frameCounter++;
         auto currentTime = std::chrono::high_resolution_clock::now();
-        double elapsedTime = std::chrono::duration_cast<std::chrono::milliseconds>(currentTime - startTime).count();
+        double elapsedTime = Milliseconds(currentTime - startTime).count();
         
         std::string fpsText = "FPS: " + std::to_string(static_cast<int>(fps));
         cv::putText(frame, fpsText, cv::Point(10, 30), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 255, 0), 2);
@@ -113,7 +129,7 @@ int main() {
         if (c == 27) break; // Выход при нажатии ESC
 
         auto displayEnd = std::chrono::high_resolution_clock::now();
-        totalOutputTime += std::chrono::duration_cast<std::chrono::milliseconds>(displayEnd - displayStart).count();
+        totalOutputTime += Milliseconds(displayEnd - displayStart).count();
 
         if (elapsedTime > 250.0) {
             fps = frameCounter * 1000.0 / elapsedTime;
@@ -125,9 +141,13 @@ int main() {
             std::cout << "Time for reading frames: " << (totalReadingTime / totalTime) * 100 << "%" << std::endl;
             std::cout << "Time for output frames: " << (totalOutputTime / totalTime) * 100 << "%" << std::endl;
             std::cout << fps << std::endl;
+            perf_print(stdout, "Processing", &processingCounters);
+            fflush(stdout);
+            processingCounters = perf_sample();
         }
 
     }
+    perf_close(&processingRegion);
     capture.release();
     cv::destroyAllWindows();
 
@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "gemm.h"
+#include "../common/tune.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#else
+static int omp_get_max_threads(void) { return 1; }
+#endif
+
+// Замеряемое умножение: A (TUNE_MK x TUNE_MK) на B (TUNE_MK x TUNE_N).
+// B шире самого большого NC, чтобы выбор NC на что-то влиял.
+#define TUNE_MK 512
+#define TUNE_N 4096
+#define TUNE_REPEATS 2
+
+struct tune_params {
+    size_t kc, mc, nc;
+    int threads;
+};
+
+static double tune_clock(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+// Ядра объявлены без const (gemm.h), поэтому запись через kern допустима
+static void apply(const struct gemm_kernel *kern, const struct tune_params *p)
+{
+    struct gemm_kernel *k = (struct gemm_kernel *)kern;
+    k->kc = p->kc;
+    k->mc = p->mc;
+    k->nc = p->nc;
+    // Только для умножений этим ядром: остальные области OpenMP
+    // работают с числом потоков по умолчанию
+    k->threads = p->threads;
+}
+
+static double measure(const struct gemm_kernel *kern, const struct tune_params *p,
+                      const float *A, const float *B, float *C)
+{
+    double best = 1e30;
+
+    apply(kern, p);
+    for (int r = 0; r < TUNE_REPEATS; ++r) {
+        double t0 = tune_clock();
+        gemm_sgemm(kern, TUNE_MK, TUNE_N, TUNE_MK, A, TUNE_MK, B, TUNE_N, C, TUNE_N, NULL);
+        double t = tune_clock() - t0;
+        if (t < best) best = t;
+    }
+    return best;
+}
+
+// Покоординатный спуск: KC, затем MC, NC и число потоков, каждый раз
+// при лучших уже найденных остальных. Полный перебор дал бы сотни замеров.
+// Порядок циклов и развёртку, в отличие от lab8/mult.c, перебирать
+// незачем: их задают регистровое микроядро MR x NR и схема Гото вокруг него.
+static void search(const struct gemm_kernel *kern, struct tune_params *best, int search_threads)
+{
+    static const size_t kcs[] = { 128, 192, 256, 320, 384, 512 };
+    static const size_t mcs[] = { 64, 96, 128, 160, 224, 320 };
+    static const size_t ncs[] = { 1024, 2048, 3072, 4096 };
+    float *A = malloc(sizeof(float) * TUNE_MK * TUNE_MK);
+    float *B = malloc(sizeof(float) * TUNE_MK * TUNE_N);
+    float *C = malloc(sizeof(float) * TUNE_MK * TUNE_N);
+
+    if (!A || !B || !C) {
+        free(A); free(B); free(C);
+        return;
+    }
+    for (size_t i = 0; i < (size_t)TUNE_MK * TUNE_MK; ++i)
+        A[i] = (float)(i % 7) - 3.0f;
+    for (size_t i = 0; i < (size_t)TUNE_MK * TUNE_N; ++i)
+        B[i] = (float)(i % 5) - 2.0f;
+
+    // Первый прогон касается страниц и прогревает частоту
+    double best_time = measure(kern, best, A, B, C);
+    best_time = measure(kern, best, A, B, C);
+
+#define TRY(field, value)                                   \
+    do {                                                    \
+        struct tune_params p = *best;                       \
+        p.field = (value);                                  \
+        double t = measure(kern, &p, A, B, C);              \
+        if (t < best_time) { best_time = t; *best = p; }    \
+    } while (0)
+
+    for (size_t i = 0; i < sizeof(kcs) / sizeof(kcs[0]); ++i)
+        TRY(kc, kcs[i]);
+    // MC и NC кратны регистровому блоку
+    for (size_t i = 0; i < sizeof(mcs) / sizeof(mcs[0]); ++i)
+        TRY(mc, (mcs[i] + kern->mr - 1) / kern->mr * kern->mr);
+    for (size_t i = 0; i < sizeof(ncs) / sizeof(ncs[0]); ++i)
+        TRY(nc, ncs[i] / kern->nr * kern->nr);
+    for (int t = 1; search_threads && t < best->threads; t *= 2)
+        TRY(threads, t);
+
+#undef TRY
+
+    free(A); free(B); free(C);
+}
+
+int gemm_autotune(const struct gemm_kernel *kern, int force)
+{
+    static struct tune_cache cache;
+    char key[4][TUNE_KEY_SIZE];
+    long value[4];
+
+    struct tune_params p = { kern->kc, kern->mc, kern->nc, omp_get_max_threads() };
+
+    snprintf(key[0], TUNE_KEY_SIZE, "lab7.%s.kc", kern->name);
+    snprintf(key[1], TUNE_KEY_SIZE, "lab7.%s.mc", kern->name);
+    snprintf(key[2], TUNE_KEY_SIZE, "lab7.%s.nc", kern->name);
+    snprintf(key[3], TUNE_KEY_SIZE, "lab7.%s.threads", kern->name);
+
+    tune_load(&cache);
+    int cached = 1;
+    for (int i = 0; i < 4; ++i)
+        cached = tune_get(&cache, key[i], &value[i]) && value[i] > 0 && cached;
+
+    // Заданное пользователем OMP_NUM_THREADS важнее найденного
+    int threads_fixed = getenv("OMP_NUM_THREADS") != NULL;
+
+    if (cached && !force) {
+        struct tune_params c = { (size_t)value[0], (size_t)value[1], (size_t)value[2],
+                                 threads_fixed ? p.threads : (int)value[3] };
+        // Кэш мог быть поправлен руками: кратность блоку обязательна
+        if (c.mc % kern->mr == 0 && c.nc % kern->nr == 0)
+            apply(kern, &c);
+        return 0;
+    }
+
+    fprintf(stderr, "Tuning %s kernel for this machine...\n", kern->name);
+    search(kern, &p, !threads_fixed);
+    apply(kern, &p);
+
+    tune_set(&cache, key[0], (long)p.kc);
+    tune_set(&cache, key[1], (long)p.mc);
+    tune_set(&cache, key[2], (long)p.nc);
+    tune_set(&cache, key[3], p.threads);
+    if (!tune_save(&cache))
+        fprintf(stderr, "Cannot write tuning cache %s\n", cache.path);
+    else
+        fprintf(stderr, "%s: KC %zu, MC %zu, NC %zu, %d threads -> %s\n", kern->name,
+                p.kc, p.mc, p.nc, p.threads, cache.path);
+    return 1;
+}
@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <string.h>
+#include <dlfcn.h>
+
+#include "matrix.h"
+#include "gemm.h"
+
+#ifdef GEMM_X86
+#include <cpuid.h>
+#endif
+
+static void sgemm_scalar(size_t m, size_t n, size_t k,
+                         const float *A, size_t lda,
+                         const float *B, size_t ldb,
+                         float *C, size_t ldc, const struct gemm_epilogue *ep)
+{
+    gemm_sgemm(&gemm_kernel_scalar, m, n, k, A, lda, B, ldb, C, ldc, ep);
+}
+
+static int scalar_available(void)
+{
+    return 1;
+}
+
+#ifdef GEMM_X86
+
+// Регистр XCR0: какие наборы регистров сохраняет ОС при переключении задач
+static unsigned long long read_xcr0(void)
+{
+    unsigned int lo, hi;
+    __asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((unsigned long long)hi << 32) | lo;
+}
+
+static int cpu_has_avx(void)
+{
+    unsigned int a, b, c, d;
+    if (!__get_cpuid(1, &a, &b, &c, &d))
+        return 0;
+    if (!(c & bit_OSXSAVE) || !(c & bit_AVX) || !(c & bit_FMA))
+        return 0;
+    return (read_xcr0() & 0x6) == 0x6;
+}
+
+static int avx2_available(void)
+{
+    unsigned int a, b, c, d;
+    if (!cpu_has_avx() || !__get_cpuid_count(7, 0, &a, &b, &c, &d))
+        return 0;
+    return (b & bit_AVX2) != 0;
+}
+
+static int avx512_available(void)
+{
+    unsigned int a, b, c, d;
+    if (!cpu_has_avx() || !__get_cpuid_count(7, 0, &a, &b, &c, &d))
+        return 0;
+    // Кроме YMM ОС должна сохранять регистры масок и верхние половины ZMM
+    return (b & bit_AVX512F) && (read_xcr0() & 0xe6) == 0xe6;
+}
+
+static void sgemm_avx2(size_t m, size_t n, size_t k,
+                       const float *A, size_t lda,
+                       const float *B, size_t ldb,
+                       float *C, size_t ldc, const struct gemm_epilogue *ep)
+{
+    gemm_sgemm(&gemm_kernel_avx2, m, n, k, A, lda, B, ldb, C, ldc, ep);
+}
+
+static void sgemm_avx512(size_t m, size_t n, size_t k,
+                         const float *A, size_t lda,
+                         const float *B, size_t ldb,
+                         float *C, size_t ldc, const struct gemm_epilogue *ep)
+{
+    gemm_sgemm(&gemm_kernel_avx512, m, n, k, A, lda, B, ldb, C, ldc, ep);
+}
+
+#endif
+
+// BLAS подгружается через dlopen, поэтому для сборки он не нужен.
+// Константы совпадают с перечислениями из cblas.h.
+enum { BLAS_ROW_MAJOR = 101, BLAS_NO_TRANS = 111 };
+
+typedef void (*cblas_sgemm_fn)(int order, int trans_a, int trans_b,
+                               int m, int n, int k, float alpha,
+                               const float *A, int lda,
+                               const float *B, int ldb,
+                               float beta, float *C, int ldc);
+
+static cblas_sgemm_fn blas_sgemm_ptr;
+
+static int blas_available(void)
+{
+    // Только оптимизированные библиотеки: эталонная libblas медленнее
+    // любого из встроенных ядер
+    static const char *libs[] = {
+        "libopenblas.so.0", "libopenblas.so", "libmkl_rt.so", "libblis.so.4"
+    };
+    static int tried = 0;
+
+    if (!tried) {
+        tried = 1;
+        for (size_t i = 0; i < sizeof(libs) / sizeof(libs[0]) && !blas_sgemm_ptr; ++i) {
+            void *handle = dlopen(libs[i], RTLD_NOW | RTLD_LOCAL);
+            if (!handle)
+                continue;
+            blas_sgemm_ptr = (cblas_sgemm_fn)dlsym(handle, "cblas_sgemm");
+            if (!blas_sgemm_ptr)
+                dlclose(handle);
+        }
+    }
+
+    return blas_sgemm_ptr != NULL;
+}
+
+// Эпилог для BLAS: beta и alpha покрывают accumulate и negate,
+// а C2 и norm2 приходится досчитывать отдельными проходами
+static void sgemm_blas(size_t m, size_t n, size_t k,
+                       const float *A, size_t lda,
+                       const float *B, size_t ldb,
+                       float *C, size_t ldc, const struct gemm_epilogue *ep)
+{
+    float alpha = 1.0f, beta = 0.0f;
+
+    if (ep && ep->negate) {
+        for (size_t i = 0; i < m; ++i) {
+            memset(C + i * ldc, 0, n * sizeof(float));
+            if (i < n)
+                C[i * ldc + i] = ep->diag;
+        }
+        alpha = -1.0f;
+        beta = 1.0f;
+    } else if (ep && ep->accumulate) {
+        beta = 1.0f;
+    }
+
+    blas_sgemm_ptr(BLAS_ROW_MAJOR, BLAS_NO_TRANS, BLAS_NO_TRANS,
+                   (int)m, (int)n, (int)k, alpha, A, (int)lda, B, (int)ldb,
+                   beta, C, (int)ldc);
+
+    if (ep && ep->C2)
+        for (size_t i = 0; i < m; ++i)
+            for (size_t j = 0; j < n; ++j)
+                ep->C2[i * ep->ldc2 + j] += C[i * ldc + j];
+
+    if (ep && ep->norm2)
+        for (size_t i = 0; i < m; ++i)
+            for (size_t j = 0; j < n; ++j)
+                *ep->norm2 += (double)C[i * ldc + j] * C[i * ldc + j];
+}
+
+// В порядке убывания скорости: "auto" берёт первую доступную
+static const struct matrix_backend backends[] = {
+#ifdef GEMM_X86
+    { "avx512", avx512_available, sgemm_avx512, &gemm_kernel_avx512 },
+    { "avx2", avx2_available, sgemm_avx2, &gemm_kernel_avx2 },
+#endif
+    { "blas", blas_available, sgemm_blas, NULL },
+    { "scalar", scalar_available, sgemm_scalar, &gemm_kernel_scalar },
+};
+
+#define BACKEND_COUNT (sizeof(backends) / sizeof(backends[0]))
+
+static const struct matrix_backend *current;
+static int current_auto;
+
+const struct matrix_backend *backend_init(const char *name)
+{
+    const struct matrix_backend *found = NULL;
+
+    for (size_t i = 0; i < BACKEND_COUNT && !found; ++i) {
+        if (!name || strcmp(name, "auto") == 0) {
+            if (backends[i].available())
+                found = &backends[i];
+        } else if (strcmp(name, backends[i].name) == 0) {
+            found = backends[i].available() ? &backends[i] : NULL;
+            break;
+        }
+    }
+
+    if (found) {
+        current = found;
+        current_auto = !name || strcmp(name, "auto") == 0;
+    }
+    return found;
+}
+
+const struct matrix_backend *backend_current(void)
+{
+    if (!current)
+        backend_init(NULL);
+    return current;
+}
+
+int backend_is_auto(void)
+{
+    backend_current();
+    return current_auto;
+}
+
+const struct matrix_backend *backend_at(size_t i)
+{
+    return i < BACKEND_COUNT ? &backends[i] : NULL;
+}
+
+void backend_print(FILE *out)
+{
+    for (size_t i = 0; i < BACKEND_COUNT; ++i)
+        fprintf(out, "%-8s %s\n", backends[i].name,
+                backends[i].available() ? "available" : "unavailable");
+}
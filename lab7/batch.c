@@ -0,0 +1,230 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "matrix.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Матрицы группы лежат в SoA-раскладке: элемент (i, j) всех BATCH_LANES
+// матриц хранится подряд, X[(i * N + j) * BATCH_LANES + l]. Тогда каждая
+// операция над элементом — одна векторная инструкция, а дорожка l целиком
+// ведёт свою матрицу. Ширина 16 — один регистр zmm или два ymm.
+#define BATCH_LANES 16
+#define BATCH_B 4
+
+#define L BATCH_LANES
+
+// Все дорожки одного элемента как один вектор (расширение GCC)
+typedef float lanes __attribute__((vector_size(L * sizeof(float))));
+
+// Векторные версии выбираются при загрузке программы (ifunc)
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+#define BATCH_CLONES __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define BATCH_CLONES
+#endif
+
+struct batch_buffers {
+    float *A, *B, *R, *power, *next, *sum;
+};
+
+// Перекладка group матриц из обычной раскладки в SoA; недостающие
+// дорожки заполняются единичными матрицами
+static void to_soa(const float *As, size_t group, size_t N, float *X)
+{
+    for (size_t l = 0; l < L; ++l) {
+        const float *src = l < group ? As + l * N * N : NULL;
+        for (size_t e = 0; e < N * N; ++e)
+            X[e * L + l] = src ? src[e] : (e / N == e % N ? 1.0f : 0.0f);
+    }
+}
+
+static void from_soa(const float *X, size_t group, size_t N, float *results)
+{
+    for (size_t l = 0; l < group; ++l) {
+        float *dst = results + l * N * N;
+        for (size_t e = 0; e < N * N; ++e)
+            dst[e] = X[e * L + l];
+    }
+}
+
+// B = A^T / (||A||_1 ||A||_inf) для всех дорожек сразу
+BATCH_CLONES
+static void soa_generate_B(const float *A, float *B, size_t N)
+{
+    float max_row[L], max_col[L], row[L];
+    float col[64 * L];
+
+    for (size_t l = 0; l < L; ++l) {
+        max_row[l] = __FLT_MIN__;
+        max_col[l] = __FLT_MIN__;
+    }
+
+    for (size_t j0 = 0; j0 < N; j0 += 64) {
+        size_t jn = N - j0 < 64 ? N - j0 : 64;
+        memset(col, 0, sizeof(col));
+
+        for (size_t i = 0; i < N; ++i)
+            for (size_t j = 0; j < jn; ++j)
+                for (size_t l = 0; l < L; ++l)
+                    col[j * L + l] += A[(i * N + j0 + j) * L + l];
+
+        for (size_t j = 0; j < jn; ++j)
+            for (size_t l = 0; l < L; ++l)
+                if (col[j * L + l] > max_col[l]) max_col[l] = col[j * L + l];
+    }
+
+    for (size_t i = 0; i < N; ++i) {
+        for (size_t l = 0; l < L; ++l)
+            row[l] = 0.0f;
+        for (size_t j = 0; j < N; ++j)
+            for (size_t l = 0; l < L; ++l)
+                row[l] += A[(i * N + j) * L + l];
+        for (size_t l = 0; l < L; ++l)
+            if (row[l] > max_row[l]) max_row[l] = row[l];
+    }
+
+    float inv[L];
+    for (size_t l = 0; l < L; ++l)
+        inv[l] = 1.0f / (max_row[l] * max_col[l]);
+
+    for (size_t i = 0; i < N; ++i)
+        for (size_t j = 0; j < N; ++j)
+            for (size_t l = 0; l < L; ++l)
+                B[(i * N + j) * L + l] = A[(j * N + i) * L + l] * inv[l];
+}
+
+// Запись одного элемента C (дорожки l) с учётом negate и sum
+#define SOA_STORE(i, j, acc) { \
+        float *c = C + ((i) * N + (j)) * L; \
+        float d = negate && (i) == (j) ? 1.0f : 0.0f; \
+        for (size_t l = 0; l < L; ++l) \
+            c[l] = negate ? d - (acc)[l] : (acc)[l]; \
+        if (sum) \
+            for (size_t l = 0; l < L; ++l) \
+                sum[((i) * N + (j)) * L + l] += c[l]; \
+    }
+
+// C = X * Y для всех дорожек; negate — C = I - X * Y;
+// sum != NULL — дополнительно sum += C тем же проходом
+BATCH_CLONES
+static void soa_multiply(const float *X, const float *Y, float *C, size_t N,
+                         int negate, float *sum)
+{
+    size_t nb = N / BATCH_B * BATCH_B;
+
+    // Блок BATCH_B x BATCH_B элементов C копится в регистрах: каждая
+    // загруженная строка X и столбец Y используются BATCH_B раз
+    for (size_t i = 0; i < nb; i += BATCH_B) {
+        for (size_t j = 0; j < nb; j += BATCH_B) {
+            lanes acc[BATCH_B][BATCH_B] = {{{0}}};
+
+            for (size_t k = 0; k < N; ++k) {
+                const lanes *y = (const lanes *)(Y + (k * N + j) * L);
+                #pragma GCC unroll 4
+                for (size_t p = 0; p < BATCH_B; ++p) {
+                    lanes x = *(const lanes *)(X + ((i + p) * N + k) * L);
+                    #pragma GCC unroll 4
+                    for (size_t q = 0; q < BATCH_B; ++q)
+                        acc[p][q] += x * y[q];
+                }
+            }
+
+            for (size_t p = 0; p < BATCH_B; ++p)
+                for (size_t q = 0; q < BATCH_B; ++q) {
+                    float out[L];
+                    memcpy(out, &acc[p][q], sizeof(out));
+                    SOA_STORE(i + p, j + q, out)
+                }
+        }
+    }
+
+    // Края, если N не делится на BATCH_B
+    for (size_t i = 0; i < N; ++i) {
+        for (size_t j = i < nb ? nb : 0; j < N; ++j) {
+            float acc[L] = {0};
+
+            for (size_t k = 0; k < N; ++k)
+                for (size_t l = 0; l < L; ++l)
+                    acc[l] += X[(i * N + k) * L + l] * Y[(k * N + j) * L + l];
+
+            SOA_STORE(i, j, acc)
+        }
+    }
+}
+
+// Тот же ряд, что и в matrix_invert, но для BATCH_LANES матриц сразу
+static void invert_group(struct batch_buffers *b, size_t N, size_t M)
+{
+    soa_generate_B(b->A, b->B, N);
+    soa_multiply(b->B, b->A, b->R, N, 1, NULL);
+
+    memcpy(b->sum, b->R, N * N * L * sizeof(float));
+    for (size_t i = 0; i < N; ++i)
+        for (size_t l = 0; l < L; ++l)
+            b->sum[(i * N + i) * L + l] += 1.0f;
+
+    const float *current_power = b->R;
+    float *out = b->power;
+    for (size_t i = 2; i <= M; ++i) {
+        soa_multiply(current_power, b->R, out, N, 0, b->sum);
+        current_power = out;
+        out = out == b->power ? b->next : b->power;
+    }
+
+    // Результат пишется на место A: исходные матрицы группы больше не нужны
+    soa_multiply(b->sum, b->B, b->A, N, 0, NULL);
+}
+
+int matrix_invert_batched(const float *As, float *results, size_t count,
+                          size_t N, size_t M)
+{
+    size_t groups = (count + L - 1) / L;
+    size_t stride = N * N * L;
+    int failed = 0;
+
+    // Для N со специализацией (fixed.cpp) развёрнутое ядро на каждую
+    // матрицу быстрее группы в SoA: строки и так лежат в регистрах
+    if (count > 0 && matrix_invert_fixed(As, results, N, M)) {
+        #pragma omp parallel for schedule(static)
+        for (size_t i = 1; i < count; ++i)
+            // При отказе ядра — общий путь, как в matrix_invert
+            if (!matrix_invert_fixed(As + i * N * N, results + i * N * N, N, M))
+                matrix_invert(As + i * N * N, results + i * N * N, N, M, NULL);
+        return 1;
+    }
+
+    #pragma omp parallel
+    {
+        // Буферы свои у каждого потока и живут весь вызов
+        float *mem = matrix_alloc(6 * stride);
+        struct batch_buffers b = {
+            mem, mem + stride, mem + 2 * stride,
+            mem + 3 * stride, mem + 4 * stride, mem + 5 * stride
+        };
+
+        if (!mem) {
+            #pragma omp atomic write
+            failed = 1;
+        }
+
+        #pragma omp for schedule(dynamic)
+        for (size_t g = 0; g < groups; ++g) {
+            if (!mem)
+                continue;
+
+            size_t first = g * L;
+            size_t group = count - first < L ? count - first : L;
+
+            to_soa(As + first * N * N, group, N, b.A);
+            invert_group(&b, N, M);
+            from_soa(b.A, group, N, results + first * N * N);
+        }
+
+        free(mem);
+    }
+
+    return !failed;
+}
@@ -0,0 +1,299 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "bench.h"
+#include "gemm.h"
+#include "../common/perf.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#else
+static int omp_get_max_threads(void) { return 1; }
+#endif
+
+// Все замеры одной конфигурации
+struct bench_result {
+    const char *backend;
+    size_t N, M, terms;
+    double wall_min, wall_median, cpu;
+    double gflops, bandwidth;
+    double residual;
+    // Расхождение с решением без Штрассена; NAN, если он не включён
+    double drift;
+    // Счётчики главного потока за все замеры; NAN, если их нет
+    double ipc, l1d_mpki, llc_mpki, dtlb_mpki;
+};
+
+static double clock_seconds(clockid_t id)
+{
+    struct timespec ts;
+    clock_gettime(id, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+size_t bench_solve(const char *mode, const float *A, float *inverseA, size_t N,
+                   size_t M, float tol, float *residual, struct matrix_workspace *ws)
+{
+    if (strcmp(mode, "doubling") == 0) {
+        matrix_invert_doubling(A, inverseA, N, M, ws);
+    } else if (strcmp(mode, "newton") == 0) {
+        return matrix_invert_newton(A, inverseA, N, M, tol, residual, ws);
+    } else {
+        return matrix_invert_tol(A, inverseA, N, M, tol, residual, ws);
+    }
+    return M;
+}
+
+double bench_residual(const float *A, const float *X, size_t N)
+{
+    float *P = matrix_alloc(N * N);
+    double sum = 0;
+    if (!P) return NAN;
+
+    matrix_multiply(A, X, P, N);
+    for (size_t i = 0; i < N; ++i)
+        for (size_t j = 0; j < N; ++j) {
+            double d = (i == j ? 1.0 : 0.0) - P[i * N + j];
+            sum += d * d;
+        }
+
+    free(P);
+    return sqrt(sum);
+}
+
+double bench_strassen_drift(const char *mode, const float *A, const float *X, size_t N,
+                            size_t M, float tol, size_t crossover,
+                            struct matrix_workspace *ws)
+{
+    float *classic = matrix_alloc(N * N);
+    float residual = 0;
+    if (!classic) return NAN;
+
+    matrix_set_strassen(0);
+    bench_solve(mode, A, classic, N, M, tol, &residual, ws);
+    matrix_set_strassen(crossover);
+
+    float max_diff = 0, max_value = 0;
+    for (size_t i = 0; i < N * N; ++i) {
+        float d = fabsf(X[i] - classic[i]);
+        float v = fabsf(classic[i]);
+        if (d > max_diff) max_diff = d;
+        if (v > max_value) max_value = v;
+    }
+
+    free(classic);
+    return max_value > 0 ? max_diff / max_value : max_diff;
+}
+
+size_t bench_parse_list(const char *s, size_t *values, size_t max)
+{
+    size_t count = 0;
+    char *end;
+
+    while (s && *s && count < max) {
+        values[count++] = strtoull(s, &end, 10);
+        if (end == s || *end != ',') break;
+        s = end + 1;
+    }
+    return count;
+}
+
+// Число умножений N x N при обращении: по нему считаются GFLOP/s.
+// terms — то, что вернул bench_solve.
+static size_t multiply_count(const char *mode, size_t M, size_t terms)
+{
+    if (strcmp(mode, "newton") == 0)
+        return 2 * terms;
+    if (strcmp(mode, "series") == 0)
+        return terms + 1;
+
+    // Тот же проход по битам, что в matrix_invert_doubling
+    size_t total = M < 1 ? 2 : M + 1, count = 2;
+    int top = 0;
+    while ((total >> (top + 1)) != 0)
+        ++top;
+    for (int bit = top - 1; bit >= 0; --bit) {
+        int odd = (total >> bit) & 1;
+        count += 1 + (bit != 0 || odd) + (odd && bit != 0);
+    }
+    return count;
+}
+
+static int bench_one(const struct bench_options *opt, size_t N, size_t M,
+                     struct bench_result *r)
+{
+    float *A = create_random_matrix(N);
+    float *X = matrix_alloc(N * N);
+    struct matrix_workspace *ws = workspace_create(N);
+    double *walls = malloc((opt->trials ? opt->trials : 1) * sizeof(double));
+    int ok = A && X && ws && walls;
+
+    if (ok) {
+        float residual = 0;
+        size_t trials = opt->trials ? opt->trials : 1;
+        struct perf_region region = {0};
+        struct perf_sample sample, total = {0};
+
+        for (size_t t = 0; t < opt->warmup; ++t)
+            bench_solve(opt->mode, A, X, N, M, opt->tol, &residual, ws);
+
+        // Процессорное время — сумма по всем потокам процесса: отношение
+        // cpu / wall показывает, сколько ядер было занято в среднем.
+        // Счётчики открываются заранее, чтобы это время туда не попало.
+        perf_open(&region);
+        double cpu_start = clock_seconds(CLOCK_PROCESS_CPUTIME_ID);
+        for (size_t t = 0; t < trials; ++t) {
+            perf_begin(&region);
+            r->terms = bench_solve(opt->mode, A, X, N, M, opt->tol, &residual, ws);
+            perf_end(&region, &sample);
+            walls[t] = sample.seconds;
+            perf_accumulate(&total, &sample);
+        }
+        r->cpu = (clock_seconds(CLOCK_PROCESS_CPUTIME_ID) - cpu_start) / trials;
+        perf_close(&region);
+        r->ipc = perf_ipc(&total);
+        r->l1d_mpki = perf_mpki(&total, PERF_L1D_MISSES);
+        r->llc_mpki = perf_mpki(&total, PERF_LLC_MISSES);
+        r->dtlb_mpki = perf_mpki(&total, PERF_DTLB_MISSES);
+
+        qsort(walls, trials, sizeof(double), compare_double);
+        r->wall_min = walls[0];
+        r->wall_median = trials % 2 ? walls[trials / 2]
+                                    : 0.5 * (walls[trials / 2 - 1] + walls[trials / 2]);
+
+        // Пропускная способность — оценка снизу: каждое умножение читает
+        // два множителя и пишет результат хотя бы по разу
+        size_t multiplies = multiply_count(opt->mode, M, r->terms);
+        r->gflops = 2.0 * N * N * N * multiplies / r->wall_median * 1e-9;
+        r->bandwidth = 3.0 * N * N * sizeof(float) * multiplies / r->wall_median * 1e-9;
+        r->residual = bench_residual(A, X, N);
+        r->drift = opt->strassen ? bench_strassen_drift(opt->mode, A, X, N, M, opt->tol,
+                                                        opt->strassen, ws)
+                                 : NAN;
+        r->N = N;
+        r->M = M;
+    }
+
+    free(A); free(X); free(walls);
+    workspace_destroy(ws);
+    return ok;
+}
+
+static void print_header(const struct bench_options *opt)
+{
+    if (strcmp(opt->format, "csv") == 0)
+        fprintf(opt->out, "backend,mode,N,M,terms,threads,trials,wall_min_s,wall_median_s,"
+                          "cpu_s,gflops,bandwidth_gbs,residual,drift,ipc,l1d_mpki,llc_mpki,dtlb_mpki\n");
+    else if (strcmp(opt->format, "json") == 0)
+        fprintf(opt->out, "[");
+    else
+        fprintf(opt->out, "%-8s %-8s %6s %5s %5s %12s %12s %12s %9s %9s %12s %10s %5s %8s\n",
+                "backend", "mode", "N", "M", "terms", "wall min, s", "wall med, s",
+                "cpu, s", "GFLOP/s", "GB/s", "||I - AX||", "drift", "IPC", "LLC MPKI");
+}
+
+static void print_result(const struct bench_options *opt, const struct bench_result *r,
+                         int first)
+{
+    if (strcmp(opt->format, "csv") == 0) {
+        fprintf(opt->out, "%s,%s,%zu,%zu,%zu,%d,%zu,%.6e,%.6e,%.6e,%.3f,%.3f,%.6e,%.6e,"
+                          "%.3f,%.3f,%.3f,%.3f\n",
+                r->backend, opt->mode, r->N, r->M, r->terms, omp_get_max_threads(),
+                opt->trials, r->wall_min, r->wall_median, r->cpu, r->gflops,
+                r->bandwidth, r->residual, r->drift, r->ipc, r->l1d_mpki, r->llc_mpki, r->dtlb_mpki);
+    } else if (strcmp(opt->format, "json") == 0) {
+        fprintf(opt->out,
+                "%s\n  {\"backend\": \"%s\", \"mode\": \"%s\", \"N\": %zu, \"M\": %zu, "
+                "\"terms\": %zu, \"threads\": %d, \"trials\": %zu, \"wall_min_s\": %.6e, "
+                "\"wall_median_s\": %.6e, \"cpu_s\": %.6e, \"gflops\": %.3f, "
+                "\"bandwidth_gbs\": %.3f, \"residual\": %.6e",
+                first ? "" : ",", r->backend, opt->mode, r->N, r->M, r->terms,
+                omp_get_max_threads(), opt->trials, r->wall_min, r->wall_median, r->cpu,
+                r->gflops, r->bandwidth, r->residual);
+        // В JSON нет NAN: отсутствующие значения просто не пишутся
+        if (!isnan(r->drift))
+            fprintf(opt->out, ", \"drift\": %.6e", r->drift);
+        if (!isnan(r->ipc))
+            fprintf(opt->out, ", \"ipc\": %.3f", r->ipc);
+        if (!isnan(r->l1d_mpki))
+            fprintf(opt->out, ", \"l1d_mpki\": %.3f", r->l1d_mpki);
+        if (!isnan(r->llc_mpki))
+            fprintf(opt->out, ", \"llc_mpki\": %.3f", r->llc_mpki);
+        if (!isnan(r->dtlb_mpki))
+            fprintf(opt->out, ", \"dtlb_mpki\": %.3f", r->dtlb_mpki);
+        fprintf(opt->out, "}");
+    } else {
+        fprintf(opt->out, "%-8s %-8s %6zu %5zu %5zu %12.6f %12.6f %12.6f %9.2f %9.2f %12.4e "
+                          "%10.3e %5.2f %8.3f\n",
+                r->backend, opt->mode, r->N, r->M, r->terms, r->wall_min, r->wall_median,
+                r->cpu, r->gflops, r->bandwidth, r->residual, r->drift, r->ipc, r->llc_mpki);
+    }
+    fflush(opt->out);
+}
+
+// Входит ли name в список через запятую
+static int in_list(const char *list, const char *name)
+{
+    size_t len = strlen(name);
+
+    while (list && *list) {
+        const char *comma = strchr(list, ',');
+        size_t item = comma ? (size_t)(comma - list) : strlen(list);
+        if (item == len && strncmp(list, name, len) == 0)
+            return 1;
+        list = comma ? comma + 1 : NULL;
+    }
+    return 0;
+}
+
+int bench_run(const struct bench_options *opt)
+{
+    const struct matrix_backend *saved = backend_current();
+    int saved_auto = backend_is_auto();
+    int all = !opt->backends || strcmp(opt->backends, "all") == 0;
+    int first = 1, failed = 0;
+
+    print_header(opt);
+
+    const struct matrix_backend *be;
+    for (size_t b = 0; (be = backend_at(b)) != NULL; ++b) {
+        if (!all && !in_list(opt->backends, be->name))
+            continue;
+        if (!be->available()) {
+            if (!all)
+                fprintf(stderr, "Backend %s is not supported on this machine\n", be->name);
+            continue;
+        }
+        backend_init(be->name);
+        if (be->kernel)
+            gemm_autotune(be->kernel, 0);
+
+        for (size_t i = 0; i < opt->N_count; ++i)
+            for (size_t j = 0; j < opt->M_count; ++j) {
+                struct bench_result r = { .backend = be->name };
+                if (!bench_one(opt, opt->Ns[i], opt->Ms[j], &r)) {
+                    fprintf(stderr, "Out of memory for N = %zu\n", opt->Ns[i]);
+                    failed = 1;
+                    continue;
+                }
+                print_result(opt, &r, first);
+                first = 0;
+            }
+    }
+
+    if (strcmp(opt->format, "json") == 0)
+        fprintf(opt->out, "\n]\n");
+
+    backend_init(saved_auto ? NULL : saved->name);
+    if (saved->kernel)
+        gemm_autotune(saved->kernel, 0);
+    return failed;
+}
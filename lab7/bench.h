@@ -0,0 +1,41 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "matrix.h"
+
+// Неинтерактивный замер: все сочетания реализаций, N и M, по warmup
+// прогревочных и trials замеряемых обращений на каждое
+struct bench_options {
+    const char *mode;       // series, doubling или newton
+    float tol;
+    const size_t *Ns;
+    size_t N_count;
+    const size_t *Ms;
+    size_t M_count;
+    // Имена реализаций через запятую; NULL или "all" — все доступные
+    const char *backends;
+    // Порог Штрассена (0 — без него); с ним в результат пишется drift
+    size_t strassen;
+    size_t warmup, trials;
+    const char *format;     // text, csv или json
+    FILE *out;
+};
+
+// Обращение выбранным методом; возвращает число членов ряда или итераций
+size_t bench_solve(const char *mode, const float *A, float *inverseA, size_t N,
+                   size_t M, float tol, float *residual, struct matrix_workspace *ws);
+// ||I - A X||_F, считается обычным умножением
+double bench_residual(const float *A, const float *X, size_t N);
+// Расхождение решения X с решением без Штрассена, max |X - X0| / max |X0|;
+// затем порог Штрассена возвращается к crossover. NAN при нехватке памяти.
+double bench_strassen_drift(const char *mode, const float *A, const float *X, size_t N,
+                            size_t M, float tol, size_t crossover,
+                            struct matrix_workspace *ws);
+// Список чисел через запятую; возвращает их количество (не больше max)
+size_t bench_parse_list(const char *s, size_t *values, size_t max);
+int bench_run(const struct bench_options *opt);
+
+#endif
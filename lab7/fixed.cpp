@@ -0,0 +1,34 @@
+#include <cstddef>
+
+#include "fixed.hpp"
+#include "matrix.h"
+
+// Векторные версии выбираются при загрузке программы (ifunc), как и
+// в batch.c; flatten встраивает шаблоны в каждую из версий
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+#define FIXED_CLONES __attribute__((target_clones("avx512f", "avx2", "default"), flatten))
+#else
+#define FIXED_CLONES
+#endif
+
+template <std::size_t N>
+FIXED_CLONES static bool invertFixed(const float *A, float *result, std::size_t M)
+{
+    return fixed::invert<N>(A, result, M);
+}
+
+extern "C" int matrix_invert_fixed(const float *A, float *result, std::size_t N, std::size_t M)
+{
+    switch (N) {
+    case 4:
+        return invertFixed<4>(A, result, M);
+    case 8:
+        return invertFixed<8>(A, result, M);
+    case 16:
+        return invertFixed<16>(A, result, M);
+    case 32:
+        return invertFixed<32>(A, result, M);
+    default:
+        return 0;
+    }
+}
@@ -0,0 +1,130 @@
+#ifndef LAB7_FIXED_HPP
+#define LAB7_FIXED_HPP
+
+#include <cstddef>
+#include <cstring>
+
+// Обращение матриц фиксированного размера: N известно при компиляции,
+// поэтому все циклы разворачиваются полностью, а строки матриц живут
+// в векторных регистрах. Алгоритм тот же, что в matrix_invert:
+// ряд I + R + ... + R^M с R = I - BA и B = A^T / (||A||_1 ||A||_inf).
+namespace fixed {
+
+// Кусок строки в один векторный регистр (расширение GCC): строка из
+// N чисел занимает Chunks таких кусков. Шире 16 чисел (zmm) не берём,
+// иначе GCC разбивает вектор через память.
+template <std::size_t N>
+struct Row {
+    static constexpr std::size_t Width = N < 16 ? N : 16;
+    static constexpr std::size_t Chunks = N / Width;
+    typedef float type __attribute__((vector_size(Width * sizeof(float))));
+};
+
+// C = X * Y; Negate — C = I - X * Y; если sum != nullptr, то ещё sum += C
+template <std::size_t N, bool Negate = false>
+inline void multiply(const float *X, const float *Y, float *C, float *sum = nullptr)
+{
+    typedef typename Row<N>::type vec;
+    constexpr std::size_t W = Row<N>::Width;
+    constexpr std::size_t Chunks = Row<N>::Chunks;
+    // Четыре строки C копятся в регистрах одновременно: каждая
+    // загруженная строка Y используется четыре раза
+    constexpr std::size_t Block = 4;
+
+    for (std::size_t i = 0; i < N; i += Block) {
+        vec acc[Block][Chunks] = {};
+
+        #pragma GCC unroll 4
+        for (std::size_t k = 0; k < N; ++k) {
+            vec y[Chunks];
+            std::memcpy(y, Y + k * N, sizeof(y));
+            #pragma GCC unroll 4
+            for (std::size_t p = 0; p < Block; ++p)
+                #pragma GCC unroll 2
+                for (std::size_t c = 0; c < Chunks; ++c)
+                    acc[p][c] += X[(i + p) * N + k] * y[c];
+        }
+
+        #pragma GCC unroll 4
+        for (std::size_t p = 0; p < Block; ++p) {
+            if (Negate) {
+                #pragma GCC unroll 2
+                for (std::size_t c = 0; c < Chunks; ++c)
+                    acc[p][c] = -acc[p][c];
+                acc[p][(i + p) / W][(i + p) % W] += 1.0f;
+            }
+            std::memcpy(C + (i + p) * N, acc[p], sizeof(acc[p]));
+            if (sum) {
+                vec s[Chunks];
+                std::memcpy(s, sum + (i + p) * N, sizeof(s));
+                #pragma GCC unroll 2
+                for (std::size_t c = 0; c < Chunks; ++c)
+                    s[c] += acc[p][c];
+                std::memcpy(sum + (i + p) * N, s, sizeof(s));
+            }
+        }
+    }
+}
+
+// false, если масштаб нулевой (все суммы строк или столбцов <= 0)
+template <std::size_t N>
+inline bool generateB(const float *A, float *B)
+{
+    alignas(64) float colSums[N] = {};
+    float maxRowSum = __FLT_MIN__;
+    float maxColSum = __FLT_MIN__;
+
+    for (std::size_t i = 0; i < N; ++i) {
+        float rowSum = 0.0f;
+        for (std::size_t j = 0; j < N; ++j) {
+            rowSum += A[i * N + j];
+            colSums[j] += A[i * N + j];
+        }
+        if (rowSum > maxRowSum) maxRowSum = rowSum;
+    }
+
+    for (std::size_t j = 0; j < N; ++j)
+        if (colSums[j] > maxColSum) maxColSum = colSums[j];
+
+    const float scalingFactor = maxRowSum * maxColSum;
+    if (scalingFactor == 0.0f)
+        return false;
+
+    for (std::size_t i = 0; i < N; ++i)
+        for (std::size_t j = 0; j < N; ++j)
+            B[i * N + j] = A[j * N + i] / scalingFactor;
+    return true;
+}
+
+// Число членов ряда задаётся во время выполнения. Как и generate_B_into,
+// при нулевом масштабе возвращает false и не трогает result.
+template <std::size_t N>
+inline bool invert(const float *A, float *result, std::size_t M)
+{
+    alignas(64) float B[N * N];
+    alignas(64) float R[N * N];
+    alignas(64) float sum[N * N];
+    alignas(64) float power[2][N * N];
+
+    if (!generateB<N>(A, B))
+        return false;
+    multiply<N, true>(B, A, R);
+
+    std::memcpy(sum, R, sizeof(sum));
+    for (std::size_t i = 0; i < N; ++i)
+        sum[i * N + i] += 1.0f;
+
+    const float *currentPower = R;
+    for (std::size_t i = 2; i <= M; ++i) {
+        float *out = power[i & 1];
+        multiply<N>(currentPower, R, out, sum);
+        currentPower = out;
+    }
+
+    multiply<N>(sum, B, result);
+    return true;
+}
+
+} // namespace fixed
+
+#endif
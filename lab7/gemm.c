@@ -0,0 +1,459 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "gemm.h"
+
+#ifdef GEMM_X86
+#include <immintrin.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#else
+static int omp_get_max_threads(void) { return 1; }
+static int omp_get_thread_num(void) { return 0; }
+#endif
+
+// Меньше этого числа умножений-сложений потоки не запускаются
+#define GEMM_PARALLEL_MIN (64 * 64 * 64)
+
+// Наибольший регистровый блок среди ядер (14 x 32)
+#define GEMM_TILE_MAX 512
+
+#define GEMM_MIN(a, b) ((a) < (b) ? (a) : (b))
+#define GEMM_CEIL_DIV(a, b) (((a) + (b) - 1) / (b))
+
+#define GEMM_REP6(X) X(0) X(1) X(2) X(3) X(4) X(5)
+#define GEMM_REP14(X) GEMM_REP6(X) X(6) X(7) X(8) X(9) X(10) X(11) X(12) X(13)
+
+// Микроядра: C[MR x NR] (+)= a * b, где a — упакованная полоска A
+// (MR чисел на каждый шаг по k), b — упакованная полоска B (NR чисел).
+// SIMD-ядра собираются с атрибутом target, поэтому весь файл компилируется
+// под базовую архитектуру, а нужное ядро выбирается во время выполнения.
+
+// Переносимое ядро 4 x 8: внутренний цикл по j компилятор векторизует сам
+static void kernel_scalar(size_t kc, const float *a, const float *b,
+                          float *c, size_t ldc, int accumulate)
+{
+    float acc[4][8] = {{0}};
+
+    for (size_t p = 0; p < kc; ++p) {
+        for (size_t i = 0; i < 4; ++i) {
+            float ai = a[i];
+            for (size_t j = 0; j < 8; ++j)
+                acc[i][j] += ai * b[j];
+        }
+        a += 4;
+        b += 8;
+    }
+
+    for (size_t i = 0; i < 4; ++i)
+        for (size_t j = 0; j < 8; ++j)
+            c[i * ldc + j] = accumulate ? c[i * ldc + j] + acc[i][j] : acc[i][j];
+}
+
+struct gemm_kernel gemm_kernel_scalar = {
+    "scalar", 4, 8, 256, 128, 4096, 0, kernel_scalar
+};
+
+#ifdef GEMM_X86
+
+#define K256_DECL(i) __m256 c##i##_0 = _mm256_setzero_ps(), c##i##_1 = _mm256_setzero_ps();
+#define K256_STEP(i) { \
+        __m256 a##i = _mm256_broadcast_ss(a + i); \
+        c##i##_0 = _mm256_fmadd_ps(a##i, b0, c##i##_0); \
+        c##i##_1 = _mm256_fmadd_ps(a##i, b1, c##i##_1); \
+    }
+#define K256_LOAD(i) \
+    c##i##_0 = _mm256_add_ps(c##i##_0, _mm256_loadu_ps(c + i * ldc)); \
+    c##i##_1 = _mm256_add_ps(c##i##_1, _mm256_loadu_ps(c + i * ldc + 8));
+#define K256_STORE(i) \
+    _mm256_storeu_ps(c + i * ldc, c##i##_0); \
+    _mm256_storeu_ps(c + i * ldc + 8, c##i##_1);
+
+// AVX2 + FMA: 6 x 16, 12 аккумуляторов из 16 регистров ymm
+__attribute__((target("avx2,fma")))
+static void kernel_avx2(size_t kc, const float *a, const float *b,
+                        float *c, size_t ldc, int accumulate)
+{
+    GEMM_REP6(K256_DECL)
+
+    for (size_t p = 0; p < kc; ++p) {
+        __m256 b0 = _mm256_load_ps(b);
+        __m256 b1 = _mm256_load_ps(b + 8);
+        _mm_prefetch((const char *)(a + 8 * 6), _MM_HINT_T0);
+        GEMM_REP6(K256_STEP)
+        a += 6;
+        b += 16;
+    }
+
+    if (accumulate) {
+        GEMM_REP6(K256_LOAD)
+    }
+    GEMM_REP6(K256_STORE)
+}
+
+struct gemm_kernel gemm_kernel_avx2 = {
+    "avx2", 6, 16, 256, 144, 4096, 0, kernel_avx2
+};
+
+#define K512_DECL(i) __m512 c##i##_0 = _mm512_setzero_ps(), c##i##_1 = _mm512_setzero_ps();
+#define K512_STEP(i) { \
+        __m512 a##i = _mm512_set1_ps(a[i]); \
+        c##i##_0 = _mm512_fmadd_ps(a##i, b0, c##i##_0); \
+        c##i##_1 = _mm512_fmadd_ps(a##i, b1, c##i##_1); \
+    }
+#define K512_LOAD(i) \
+    c##i##_0 = _mm512_add_ps(c##i##_0, _mm512_loadu_ps(c + i * ldc)); \
+    c##i##_1 = _mm512_add_ps(c##i##_1, _mm512_loadu_ps(c + i * ldc + 16));
+#define K512_STORE(i) \
+    _mm512_storeu_ps(c + i * ldc, c##i##_0); \
+    _mm512_storeu_ps(c + i * ldc + 16, c##i##_1);
+
+// AVX-512: 14 x 32, 28 аккумуляторов из 32 регистров zmm
+__attribute__((target("avx512f")))
+static void kernel_avx512(size_t kc, const float *a, const float *b,
+                          float *c, size_t ldc, int accumulate)
+{
+    GEMM_REP14(K512_DECL)
+
+    for (size_t p = 0; p < kc; ++p) {
+        __m512 b0 = _mm512_load_ps(b);
+        __m512 b1 = _mm512_load_ps(b + 16);
+        _mm_prefetch((const char *)(a + 8 * 14), _MM_HINT_T0);
+        GEMM_REP14(K512_STEP)
+        a += 14;
+        b += 32;
+    }
+
+    if (accumulate) {
+        GEMM_REP14(K512_LOAD)
+    }
+    GEMM_REP14(K512_STORE)
+}
+
+struct gemm_kernel gemm_kernel_avx512 = {
+    "avx512", 14, 32, 384, 112, 3072, 0, kernel_avx512
+};
+
+#endif
+
+static float *gemm_alloc(size_t count)
+{
+    size_t bytes = (count * sizeof(float) + 63) & ~(size_t)63;
+    return aligned_alloc(64, bytes);
+}
+
+// Буферы упаковки живут между вызовами и только растут, поэтому
+// повторные умножения не обращаются к куче. У каждого вызывающего
+// потока свой буфер.
+static _Thread_local float *scratch;
+static _Thread_local size_t scratch_size;
+
+static float *gemm_scratch(size_t count)
+{
+    if (count > scratch_size) {
+        free(scratch);
+        scratch = gemm_alloc(count);
+        scratch_size = scratch ? count : 0;
+    }
+    return scratch;
+}
+
+// Упаковка блока A (mc x kc) в полоски по MR строк, хвост дополняется нулями
+static void pack_a(size_t MR, size_t mc, size_t kc, const float *A, size_t lda, float *ap)
+{
+    for (size_t ir = 0; ir < mc; ir += MR) {
+        size_t mr = GEMM_MIN(MR, mc - ir);
+        const float *src = A + ir * lda;
+
+        for (size_t p = 0; p < kc; ++p) {
+            size_t i = 0;
+            for (; i < mr; ++i)
+                ap[i] = src[i * lda + p];
+            for (; i < MR; ++i)
+                ap[i] = 0.0f;
+            ap += MR;
+        }
+    }
+}
+
+// Упаковка одной полоски B (kc x nr) шириной NR, хвост дополняется нулями
+static void pack_b(size_t NR, size_t kc, size_t nr, const float *B, size_t ldb, float *bp)
+{
+    for (size_t p = 0; p < kc; ++p) {
+        const float *src = B + p * ldb;
+        size_t j = 0;
+        for (; j < nr; ++j)
+            bp[j] = src[j];
+        for (; j < NR; ++j)
+            bp[j] = 0.0f;
+        bp += NR;
+    }
+}
+
+// Эпилог над готовым блоком C (mr x nr), пока он ещё в L1;
+// row и col — положение блока в C
+static void apply_epilogue(const struct gemm_epilogue *ep, float *c, size_t ldc,
+                           size_t mr, size_t nr, size_t row, size_t col)
+{
+    if (ep->negate) {
+        for (size_t i = 0; i < mr; ++i)
+            for (size_t j = 0; j < nr; ++j)
+                c[i * ldc + j] = -c[i * ldc + j];
+        for (size_t i = 0; i < mr; ++i)
+            if (row + i >= col && row + i < col + nr)
+                c[i * ldc + row + i - col] += ep->diag;
+    }
+
+    if (ep->norm2) {
+        double s = 0;
+        for (size_t i = 0; i < mr; ++i)
+            for (size_t j = 0; j < nr; ++j)
+                s += (double)c[i * ldc + j] * c[i * ldc + j];
+        #pragma omp atomic
+        *ep->norm2 += s;
+    }
+
+    if (ep->C2) {
+        float *c2 = ep->C2 + row * ep->ldc2 + col;
+        for (size_t i = 0; i < mr; ++i)
+            for (size_t j = 0; j < nr; ++j)
+                c2[i * ep->ldc2 + j] += c[i * ldc + j];
+    }
+}
+
+// Обход блока C (mc x полоски [s_begin, s_end)) микроядром.
+// ep != NULL только на последней панели по k; ic, jc — положение блока в C.
+static void macro_kernel(const struct gemm_kernel *kern,
+                         size_t mc, size_t nc, size_t kc,
+                         size_t s_begin, size_t s_end,
+                         const float *ap, const float *bp,
+                         float *C, size_t ldc, int accumulate,
+                         const struct gemm_epilogue *ep, size_t ic, size_t jc)
+{
+    const size_t MR = kern->mr, NR = kern->nr;
+    float tile[GEMM_TILE_MAX] __attribute__((aligned(64)));
+
+    for (size_t s = s_begin; s < s_end; ++s) {
+        size_t jr = s * NR;
+        size_t nr = GEMM_MIN(NR, nc - jr);
+        const float *bs = bp + s * kc * NR;
+
+        for (size_t ir = 0; ir < mc; ir += MR) {
+            size_t mr = GEMM_MIN(MR, mc - ir);
+            const float *as = ap + ir * kc;
+            float *c = C + ir * ldc + jr;
+
+            if (mr == MR && nr == NR) {
+                kern->micro(kc, as, bs, c, ldc, accumulate);
+            } else {
+                // Краевой блок считается во временный буфер
+                kern->micro(kc, as, bs, tile, NR, 0);
+                for (size_t i = 0; i < mr; ++i)
+                    for (size_t j = 0; j < nr; ++j)
+                        c[i * ldc + j] = accumulate ? c[i * ldc + j] + tile[i * NR + j]
+                                                    : tile[i * NR + j];
+            }
+
+            if (ep)
+                apply_epilogue(ep, c, ldc, mr, nr, ic + ir, jc + jr);
+        }
+    }
+}
+
+static void gemm_naive(size_t m, size_t n, size_t k,
+                       const float *A, size_t lda,
+                       const float *B, size_t ldb,
+                       float *C, size_t ldc, int accumulate)
+{
+    for (size_t i = 0; i < m; ++i) {
+        if (!accumulate)
+            memset(C + i * ldc, 0, n * sizeof(float));
+        for (size_t p = 0; p < k; ++p) {
+            float a = A[i * lda + p];
+            for (size_t j = 0; j < n; ++j)
+                C[i * ldc + j] += a * B[p * ldb + j];
+        }
+    }
+}
+
+// Смещение упакованной полоски (jc, pc) в матрице, упакованной gemm_pack_b:
+// блоки по NC столбцов идут подряд, внутри — панели по KC строк
+static size_t packed_offset(size_t NR, size_t k, size_t jc, size_t pc, size_t nc)
+{
+    return jc * k + pc * GEMM_CEIL_DIV(nc, NR) * NR;
+}
+
+// Наивное умножение по уже упакованной B (запасной путь без буфера)
+static void gemm_naive_packed(const struct gemm_kernel *kern,
+                              size_t m, size_t n, size_t k,
+                              const float *A, size_t lda, const float *packed,
+                              float *C, size_t ldc, int accumulate)
+{
+    const size_t NR = kern->nr, KC = kern->kc, NC = kern->nc;
+
+    for (size_t i = 0; i < m; ++i) {
+        if (!accumulate)
+            memset(C + i * ldc, 0, n * sizeof(float));
+        for (size_t jc = 0; jc < n; jc += NC) {
+            size_t nc = GEMM_MIN(NC, n - jc);
+            for (size_t pc = 0; pc < k; pc += KC) {
+                size_t kc = GEMM_MIN(KC, k - pc);
+                const float *bp = packed + packed_offset(NR, k, jc, pc, nc);
+                for (size_t p = 0; p < kc; ++p) {
+                    float a = A[i * lda + pc + p];
+                    for (size_t j = 0; j < nc; ++j)
+                        C[i * ldc + jc + j] += a * bp[(j / NR) * kc * NR + p * NR + j % NR];
+                }
+            }
+        }
+    }
+}
+
+size_t gemm_packed_b_size(const struct gemm_kernel *kern, size_t k, size_t n)
+{
+    return GEMM_CEIL_DIV(n, kern->nr) * kern->nr * k;
+}
+
+void gemm_pack_b(const struct gemm_kernel *kern, size_t k, size_t n,
+                 const float *B, size_t ldb, float *packed)
+{
+    const size_t NR = kern->nr, KC = kern->kc, NC = kern->nc;
+
+    for (size_t jc = 0; jc < n; jc += NC) {
+        size_t nc = GEMM_MIN(NC, n - jc);
+        size_t n_slivers = GEMM_CEIL_DIV(nc, NR);
+
+        for (size_t pc = 0; pc < k; pc += KC) {
+            size_t kc = GEMM_MIN(KC, k - pc);
+            float *bp = packed + packed_offset(NR, k, jc, pc, nc);
+
+            #pragma omp parallel for schedule(static) if (n * k >= GEMM_PARALLEL_MIN)
+            for (size_t s = 0; s < n_slivers; ++s) {
+                size_t jr = s * NR;
+                pack_b(NR, kc, GEMM_MIN(NR, nc - jr), B + pc * ldb + jc + jr, ldb,
+                       bp + s * kc * NR);
+            }
+        }
+    }
+}
+
+// Общий драйвер; если packed != NULL, B уже упакована и не читается
+static void gemm_run(const struct gemm_kernel *kern,
+                     size_t m, size_t n, size_t k,
+                     const float *A, size_t lda,
+                     const float *B, size_t ldb, const float *packed,
+                     float *C, size_t ldc, const struct gemm_epilogue *ep)
+{
+    if (m == 0 || n == 0)
+        return;
+
+    int beta = ep && ep->accumulate && !ep->negate;
+    int has_epilogue = ep && (ep->negate || ep->C2 || ep->norm2);
+
+    if (k == 0) {
+        for (size_t i = 0; i < m && !beta; ++i)
+            memset(C + i * ldc, 0, n * sizeof(float));
+        if (has_epilogue)
+            apply_epilogue(ep, C, ldc, m, n, 0, 0);
+        return;
+    }
+
+    const size_t MR = kern->mr, NR = kern->nr;
+    const size_t KC = kern->kc, MC = kern->mc, NC = kern->nc;
+
+    int nthreads = kern->threads > 0 ? kern->threads : omp_get_max_threads();
+    if ((double)m * n * k < GEMM_PARALLEL_MIN)
+        nthreads = 1;
+
+    size_t mc_max = GEMM_MIN(MC, GEMM_CEIL_DIV(m, MR) * MR);
+    size_t nc_max = GEMM_MIN(NC, GEMM_CEIL_DIV(n, NR) * NR);
+    size_t kc_max = GEMM_MIN(KC, k);
+
+    size_t bp_size = packed ? 0 : GEMM_CEIL_DIV(kc_max * nc_max, 16) * 16;
+    float *buf = gemm_scratch(bp_size + kc_max * mc_max * (size_t)nthreads);
+    if (!buf) {
+        if (packed)
+            gemm_naive_packed(kern, m, n, k, A, lda, packed, C, ldc, beta);
+        else
+            gemm_naive(m, n, k, A, lda, B, ldb, C, ldc, beta);
+        if (has_epilogue)
+            apply_epilogue(ep, C, ldc, m, n, 0, 0);
+        return;
+    }
+    float *bp_buf = buf;
+    float *ap_all = buf + bp_size;
+
+    size_t n_ic = GEMM_CEIL_DIV(m, mc_max);
+
+    #pragma omp parallel num_threads(nthreads)
+    {
+        float *ap = ap_all + kc_max * mc_max * (size_t)omp_get_thread_num();
+
+        for (size_t jc = 0; jc < n; jc += NC) {
+            size_t nc = GEMM_MIN(NC, n - jc);
+            size_t n_slivers = GEMM_CEIL_DIV(nc, NR);
+
+            // Если блоков по строкам меньше, чем потоков, панель B
+            // дополнительно делится по столбцам
+            size_t n_jp = GEMM_CEIL_DIV(2 * (size_t)nthreads, n_ic);
+            if (n_jp > n_slivers)
+                n_jp = n_slivers;
+            if (nthreads == 1)
+                n_jp = 1;
+            size_t per_jp = GEMM_CEIL_DIV(n_slivers, n_jp);
+
+            for (size_t pc = 0; pc < k; pc += KC) {
+                size_t kc = GEMM_MIN(KC, k - pc);
+                int accumulate = pc != 0 || beta;
+                // Эпилог применяется к блоку C, когда он досчитан
+                const struct gemm_epilogue *last = has_epilogue && pc + kc == k ? ep : NULL;
+                const float *bp = bp_buf;
+
+                if (packed) {
+                    bp = packed + packed_offset(NR, k, jc, pc, nc);
+                } else {
+                    #pragma omp for schedule(static)
+                    for (size_t s = 0; s < n_slivers; ++s) {
+                        size_t jr = s * NR;
+                        pack_b(NR, kc, GEMM_MIN(NR, nc - jr), B + pc * ldb + jc + jr, ldb,
+                               bp_buf + s * kc * NR);
+                    }
+                }
+
+                #pragma omp for schedule(dynamic, 1)
+                for (size_t w = 0; w < n_ic * n_jp; ++w) {
+                    size_t ic = (w / n_jp) * mc_max;
+                    size_t s_begin = (w % n_jp) * per_jp;
+                    size_t s_end = GEMM_MIN(s_begin + per_jp, n_slivers);
+                    if (s_begin >= s_end)
+                        continue;
+
+                    size_t mc = GEMM_MIN(mc_max, m - ic);
+                    pack_a(MR, mc, kc, A + ic * lda + pc, lda, ap);
+                    macro_kernel(kern, mc, nc, kc, s_begin, s_end, ap, bp,
+                                 C + ic * ldc + jc, ldc, accumulate, last, ic, jc);
+                }
+            }
+        }
+    }
+}
+
+void gemm_sgemm(const struct gemm_kernel *kern,
+                size_t m, size_t n, size_t k,
+                const float *A, size_t lda,
+                const float *B, size_t ldb,
+                float *C, size_t ldc, const struct gemm_epilogue *ep)
+{
+    gemm_run(kern, m, n, k, A, lda, B, ldb, NULL, C, ldc, ep);
+}
+
+void gemm_sgemm_packed(const struct gemm_kernel *kern,
+                       size_t m, size_t n, size_t k,
+                       const float *A, size_t lda,
+                       const float *packed_B,
+                       float *C, size_t ldc, const struct gemm_epilogue *ep)
+{
+    gemm_run(kern, m, n, k, A, lda, NULL, 0, packed_B, C, ldc, ep);
+}
@@ -0,0 +1,80 @@
+#ifndef LAB7_GEMM_H
+#define LAB7_GEMM_H
+
+#include <stddef.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define GEMM_X86 1
+#endif
+
+// Микроядро и параметры блокирования (схема Гото/BLIS):
+// MR x NR — регистровый блок микроядра,
+// KC x NR — полоска B, живущая в L1,
+// MC x KC — упакованный блок A, живущий в L2,
+// KC x NC — упакованная панель B, живущая в L3.
+// threads — потоки одного умножения (0 — omp_get_max_threads()).
+struct gemm_kernel {
+    const char *name;
+    size_t mr, nr;
+    size_t kc, mc, nc;
+    int threads;
+    void (*micro)(size_t kc, const float *a, const float *b,
+                  float *c, size_t ldc, int accumulate);
+};
+
+// Блокирование и threads подбирает под машину gemm_autotune, поэтому
+// ядра не константны; менять его можно только между умножениями
+extern struct gemm_kernel gemm_kernel_scalar;
+#ifdef GEMM_X86
+extern struct gemm_kernel gemm_kernel_avx2;
+extern struct gemm_kernel gemm_kernel_avx512;
+#endif
+
+// Эпилог умножения: применяется к готовому блоку C, пока он в кэше,
+// вместо отдельных проходов по памяти после GEMM.
+//   accumulate — C += A * B (beta = 1);
+//   negate     — C = diag * I - A * B (accumulate при этом игнорируется);
+//   C2         — дополнительно C2 += итоговое C (шаг строки ldc2);
+//   norm2      — к *norm2 прибавляется сумма квадратов итогового C
+//                (квадрат нормы Фробениуса), пока блок ещё в кэше.
+// C2 может совпадать с правым множителем B: блок C2 пишется только
+// после упаковки всех панелей B для своих столбцов.
+struct gemm_epilogue {
+    int accumulate;
+    int negate;
+    float diag;
+    float *C2;
+    size_t ldc2;
+    double *norm2;
+};
+
+// C = A * B для матриц в построчном хранении:
+// A — m x k (шаг строки lda), B — k x n (ldb), C — m x n (ldc).
+// Содержимое C перезаписывается, если эпилог ep (может быть NULL)
+// не говорит иного.
+void gemm_sgemm(const struct gemm_kernel *kern,
+                size_t m, size_t n, size_t k,
+                const float *A, size_t lda,
+                const float *B, size_t ldb,
+                float *C, size_t ldc, const struct gemm_epilogue *ep);
+
+// Упаковка правого множителя целиком, чтобы многократно умножать на одну
+// и ту же матрицу без повторной упаковки. Размер буфера — в числах float,
+// буфер должен быть выровнен на 64 байта.
+size_t gemm_packed_b_size(const struct gemm_kernel *kern, size_t k, size_t n);
+void gemm_pack_b(const struct gemm_kernel *kern, size_t k, size_t n,
+                 const float *B, size_t ldb, float *packed);
+
+// То же, что gemm_sgemm, но B уже упакована gemm_pack_b тем же ядром
+void gemm_sgemm_packed(const struct gemm_kernel *kern,
+                       size_t m, size_t n, size_t k,
+                       const float *A, size_t lda,
+                       const float *packed_B,
+                       float *C, size_t ldc, const struct gemm_epilogue *ep);
+
+// Автотюнер (autotune.c): KC, MC, NC ядра kern и число потоков берутся из
+// кэша настроек машины (common/tune.h), а если их там нет или force —
+// подбираются замерами и сохраняются. Возвращает 1, если был поиск.
+int gemm_autotune(const struct gemm_kernel *kern, int force);
+
+#endif
@@ -1,160 +1,529 @@
+// Сборка: gcc -O3 -fopenmp -c main.c matrix.c backend.c gemm.c batch.c strassen.c ooc.c
+//         random.c sparse.c bench.c shard.c autotune.c ../common/tune.c
+//         ../common/perf.c && g++ -O3 -c fixed.cpp &&
+//         g++ -fopenmp *.o -o lab7 -ldl -lm -lpthread -lrt
 #include <stdlib.h>
 #include <stdio.h>
 #include <time.h>
-#include <sys/times.h>
 #include <unistd.h>
 #include <string.h>
+#include <math.h>
 
-float *create_identity_matrix(size_t N)
+#include "matrix.h"
+#include "bench.h"
+#include "gemm.h"
+#include "../common/perf.h"
+
+static double wall_time(void)
 {
-    float *Im = calloc(N * N, sizeof(float));
-    if (!Im) return NULL;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
 
-    for (size_t i = 0; i < N; ++i)
-        Im[i * N + i] = 1.0f;
+// Пакетный режим: count случайных матриц обращаются matrix_invert_batched
+// и, для сравнения, по одной через matrix_invert
+static int run_batch(size_t count, size_t N, size_t M)
+{
+    float *As = malloc(count * N * N * sizeof(float));
+    float *batched = malloc(count * N * N * sizeof(float));
+    float *single = malloc(count * N * N * sizeof(float));
+
+    if (!As || !batched || !single) {
+        free(As); free(batched); free(single);
+        return 1;
+    }
+
+    random_fill(As, 0, count * N * N);
+
+    double t0 = wall_time();
+    int ok = matrix_invert_batched(As, batched, count, N, M);
+    double t1 = wall_time();
+    for (size_t i = 0; i < count; ++i)
+        matrix_invert(As + i * N * N, single + i * N * N, N, M, NULL);
+    double t2 = wall_time();
+
+    float max_diff = 0;
+    for (size_t i = 0; i < count * N * N; ++i) {
+        float d = batched[i] - single[i];
+        if (d < 0) d = -d;
+        if (d > max_diff) max_diff = d;
+    }
 
-    return Im;
+    if (ok) {
+        printf("Batched: %.0f matrices/s (%lf seconds)\n", count / (t1 - t0), t1 - t0);
+        printf("One by one: %.0f matrices/s (%lf seconds)\n", count / (t2 - t1), t2 - t1);
+        printf("Max difference: %e\n", max_diff);
+    }
+
+    free(As); free(batched); free(single);
+    return !ok;
 }
 
-float *generate_B(const float *A, size_t N)
+// Сравнение специализированных ядер с общим путём matrix_invert для
+// всех размеров, у которых есть специализация
+static int run_fixed_bench(size_t M)
 {
-    float max_row_sum = __FLT_MIN__;
-    float max_col_sum = __FLT_MIN__;
+    static const size_t sizes[] = { 4, 8, 16, 32 };
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        size_t N = sizes[s];
+        // Примерно одинаковый объём работы для каждого размера
+        size_t reps = (size_t)4e8 / (N * N * N * (M + 2)) + 1;
+        float *A = create_random_matrix(N);
+        float *generic = malloc(N * N * sizeof(float));
+        float *fixed = malloc(N * N * sizeof(float));
+        struct matrix_workspace *ws = workspace_create(N);
+
+        if (!A || !generic || !fixed || !ws) {
+            free(A); free(generic); free(fixed); workspace_destroy(ws);
+            return 1;
+        }
+
+        matrix_set_fixed(0);
+        double t0 = wall_time();
+        for (size_t r = 0; r < reps; ++r)
+            matrix_invert(A, generic, N, M, ws);
+        double t1 = wall_time();
+        for (size_t r = 0; r < reps; ++r)
+            matrix_invert_fixed(A, fixed, N, M);
+        double t2 = wall_time();
+        matrix_set_fixed(1);
+
+        float max_diff = 0;
+        for (size_t i = 0; i < N * N; ++i) {
+            float d = generic[i] - fixed[i];
+            if (d < 0) d = -d;
+            if (d > max_diff) max_diff = d;
+        }
 
-    float *row_sums = calloc(N, sizeof(float));
-    float *col_sums = calloc(N, sizeof(float));
-    if (!row_sums || !col_sums) {
-        free(row_sums);
-        free(col_sums);
-        return NULL;
+        printf("N = %2zu: generic %.2f us, fixed %.2f us, speedup %.1fx, max difference %e\n",
+               N, 1e6 * (t1 - t0) / reps, 1e6 * (t2 - t1) / reps,
+               (t1 - t0) / (t2 - t1), max_diff);
+
+        free(A); free(generic); free(fixed);
+        workspace_destroy(ws);
     }
 
-    for (size_t i = 0; i < N; ++i) {
-        for (size_t j = 0; j < N; ++j) {
-            row_sums[i] += A[i * N + j];
-            col_sums[j] += A[i * N + j];
-        }
+    return 0;
+}
+
+// Обращение вне памяти в каталоге dir и, если матрицы помещаются в
+// половину оперативной памяти, то же обращение в памяти для сравнения
+static int run_ooc(const char *dir, size_t N, size_t M, size_t tile)
+{
+    double flops = 2.0 * N * N * N * (M + 1);
+
+    if (!ooc_create_random(dir, N, tile)) {
+        perror(dir);
+        return 1;
     }
 
-    for (size_t i = 0; i < N; ++i) {
-        if (row_sums[i] > max_row_sum) max_row_sum = row_sums[i];
-        if (col_sums[i] > max_col_sum) max_col_sum = col_sums[i];
+    double t0 = wall_time();
+    int ok = matrix_invert_ooc(dir, N, M, tile);
+    double t1 = wall_time();
+    if (!ok) {
+        fprintf(stderr, "Out-of-core inversion in %s failed\n", dir);
+        return 1;
     }
+    printf("Out-of-core: %lf seconds, %.2f GFLOP/s\n", t1 - t0, flops / (t1 - t0) * 1e-9);
 
-    free(row_sums);
-    free(col_sums);
+    double in_core_bytes = 7.0 * N * N * sizeof(float);
+    double ram = (double)sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE);
+    if (in_core_bytes > ram / 2) {
+        printf("In-core: skipped, needs %.1f GB\n", in_core_bytes / (1 << 30));
+        return 0;
+    }
 
-    float *B = calloc(N * N, sizeof(float));
-    if (!B) return NULL;
+    float *A = matrix_alloc(N * N);
+    float *X = matrix_alloc(N * N);
+    float *inverseA = matrix_alloc(N * N);
+    if (!A || !X || !inverseA || !ooc_load(dir, "A.bin", A, N, tile) ||
+        !ooc_load(dir, "X.bin", X, N, tile)) {
+        free(A); free(X); free(inverseA);
+        return 1;
+    }
 
-    float scaling_factor = max_row_sum * max_col_sum;
-    if (scaling_factor == 0) return NULL;
+    t0 = wall_time();
+    matrix_invert(A, inverseA, N, M, NULL);
+    t1 = wall_time();
 
-    for (size_t i = 0; i < N; ++i)
-        for (size_t j = 0; j < N; ++j)
-            B[i * N + j] = A[j * N + i] / scaling_factor;
+    float max_diff = 0;
+    for (size_t i = 0; i < N * N; ++i) {
+        float d = X[i] - inverseA[i];
+        if (d < 0) d = -d;
+        if (d > max_diff) max_diff = d;
+    }
+    printf("In-core: %lf seconds, %.2f GFLOP/s\n", t1 - t0, flops / (t1 - t0) * 1e-9);
+    printf("Max difference: %e\n", max_diff);
 
-    return B;
+    free(A); free(X); free(inverseA);
+    return 0;
 }
 
-float *create_random_matrix(size_t N)
+// Обращение в workers процессах и, для сравнения, в одном процессе
+static int run_sharded(int workers, size_t N, size_t M)
 {
-    float *M = calloc(N * N, sizeof(float));
-    if (!M) return NULL;
+    float *A = create_random_matrix(N);
+    float *sharded = matrix_alloc(N * N);
+    float *single = matrix_alloc(N * N);
+
+    if (!A || !sharded || !single) {
+        free(A); free(sharded); free(single);
+        return 1;
+    }
+
+    double t0 = wall_time();
+    int ok = matrix_invert_sharded(A, sharded, N, M, workers);
+    double t1 = wall_time();
+    if (!ok) {
+        fprintf(stderr, "Sharded inversion in %d processes failed\n", workers);
+        free(A); free(sharded); free(single);
+        return 1;
+    }
+    matrix_invert(A, single, N, M, NULL);
+    double t2 = wall_time();
+
+    float max_diff = 0, max_value = 0;
+    for (size_t i = 0; i < N * N; ++i) {
+        float d = sharded[i] - single[i];
+        float v = single[i];
+        if (d < 0) d = -d;
+        if (v < 0) v = -v;
+        if (d > max_diff) max_diff = d;
+        if (v > max_value) max_value = v;
+    }
 
-    for (size_t i = 0; i < N * N; ++i)
-        M[i] = rand() / (float)RAND_MAX;
+    printf("Sharded: %d processes on %d NUMA nodes, %lf seconds\n",
+           workers, shard_node_count(), t1 - t0);
+    printf("Single process: %lf seconds\n", t2 - t1);
+    printf("Max relative difference: %e\n", max_value > 0 ? max_diff / max_value : max_diff);
 
-    return M;
+    free(A); free(sharded); free(single);
+    return 0;
 }
 
-void matrix_multiply(const float *A, const float *B, float *C, size_t N)
+// Исходный однопоточный вариант generate_B: эталон для --bench-B
+static float generate_B_reference(const float *A, float *B, size_t N)
 {
+    float *sums = calloc(2 * N, sizeof(float));
+    float max_row_sum = __FLT_MIN__, max_col_sum = __FLT_MIN__;
+    if (!sums) return 0;
+
     for (size_t i = 0; i < N; ++i)
-        for (size_t k = 0; k < N; ++k) {
-            float a = A[i * N + k];
-            for (size_t j = 0; j < N; ++j)
-                C[i * N + j] += a * B[k * N + j];
+        for (size_t j = 0; j < N; ++j) {
+            sums[i] += A[i * N + j];
+            sums[N + j] += A[i * N + j];
         }
-}
+    for (size_t i = 0; i < N; ++i) {
+        if (sums[i] > max_row_sum) max_row_sum = sums[i];
+        if (sums[N + i] > max_col_sum) max_col_sum = sums[N + i];
+    }
+    free(sums);
 
-void matrix_subtract(const float *A, const float *B, float *C, size_t N)
-{
-    for (size_t i = 0; i < N * N; ++i)
-        C[i] = A[i] - B[i];
+    float scaling_factor = max_row_sum * max_col_sum;
+    for (size_t i = 0; i < N; ++i)
+        for (size_t j = 0; j < N; ++j)
+            B[i * N + j] = A[j * N + i] / scaling_factor;
+    return scaling_factor;
 }
 
-void matrix_add(const float *A, const float *B, float *C, size_t N)
+// Отдельный замер generate_B: A читается дважды, B пишется один раз
+static int run_generate_B_bench(size_t N)
 {
-    for (size_t i = 0; i < N * N; ++i)
-        C[i] = A[i] + B[i];
-}
+    float *A = create_random_matrix(N);
+    float *B = matrix_alloc(N * N);
+    float *reference = matrix_alloc(N * N);
+    float *sums = matrix_alloc(generate_B_sums_size(N));
+    double bytes = 3.0 * N * N * sizeof(float);
+
+    if (!A || !B || !reference || !sums) {
+        free(A); free(B); free(reference); free(sums);
+        return 1;
+    }
 
-void matrix_invert(const float *A, float *result, size_t N, size_t M)
-{
-    float *Im = create_identity_matrix(N);
-    float *B = generate_B(A, N);
+    // Первые вызовы только касаются страниц B
+    generate_B_reference(A, reference, N);
+    generate_B_into(A, B, sums, N);
+
+    double t0 = wall_time();
+    generate_B_reference(A, reference, N);
+    double t1 = wall_time();
+    generate_B_into(A, B, sums, N);
+    double t2 = wall_time();
+
+    float max_diff = 0, max_value = 0;
+    for (size_t i = 0; i < N * N; ++i) {
+        float d = B[i] - reference[i];
+        if (d < 0) d = -d;
+        if (d > max_diff) max_diff = d;
+        if (reference[i] > max_value) max_value = reference[i];
+    }
 
-    if (!Im || !B) return;
+    printf("Reference: %lf seconds, %.2f GB/s\n", t1 - t0, bytes / (t1 - t0) * 1e-9);
+    printf("generate_B: %lf seconds, %.2f GB/s, speedup %.1fx\n",
+           t2 - t1, bytes / (t2 - t1) * 1e-9, (t1 - t0) / (t2 - t1));
+    printf("Max relative difference: %e\n", max_value > 0 ? max_diff / max_value : max_diff);
 
-    float *R = calloc(N * N, sizeof(float));
-    float *current_power = calloc(N * N, sizeof(float));
-    float *temp_result = calloc(N * N, sizeof(float));
+    free(A); free(B); free(reference); free(sums);
+    return 0;
+}
 
-    if (!R || !current_power || !temp_result) {
-        free(Im); free(B); free(R); free(current_power); free(temp_result);
-        return;
+// Разреженная A (лента полуширины param или случайная с плотностью param):
+// обращение в CSR и, для сравнения, плотным рядом. Память плотного пути —
+// семь матриц N x N, как у рабочей области с A и результатом.
+static int run_sparse(const char *kind, double param, size_t N, size_t M, float fill)
+{
+    struct csr_matrix *A = strcmp(kind, "banded") == 0 ? csr_banded(N, (size_t)param)
+                                                       : csr_random(N, (float)param);
+    float *sparse_result = matrix_alloc(N * N);
+    float *dense_result = matrix_alloc(N * N);
+    float *dense_A = matrix_alloc(N * N);
+    struct sparse_stats stats;
+
+    if (!A || !sparse_result || !dense_result || !dense_A) {
+        csr_destroy(A); free(sparse_result); free(dense_result); free(dense_A);
+        return 1;
     }
 
-    float *BA = calloc(N * N, sizeof(float));
-    matrix_multiply(B, A, BA, N);
-    matrix_subtract(Im, BA, R, N);
-
-    memcpy(current_power, R, N * N * sizeof(float));
-    matrix_add(Im, R, result, N);
+    printf("Sparse A: %s, nnz %zu (%.3f%%)\n", kind, A->nnz, 100.0 * A->nnz / ((double)N * N));
+
+    double t0 = wall_time();
+    int ok = matrix_invert_sparse(A, sparse_result, M, fill, &stats);
+    double t1 = wall_time();
+    csr_to_dense(A, dense_A);
+    double t2 = wall_time();
+    matrix_invert(dense_A, dense_result, N, M, NULL);
+    double t3 = wall_time();
+
+    if (ok) {
+        float max_diff = 0;
+        for (size_t i = 0; i < N * N; ++i) {
+            float d = sparse_result[i] - dense_result[i];
+            if (d < 0) d = -d;
+            if (d > max_diff) max_diff = d;
+        }
 
-    for (size_t i = 2; i <= M; ++i) {
-        matrix_multiply(current_power, R, temp_result, N);
-        matrix_add(result, temp_result, result, N);
-        memcpy(current_power, temp_result, N * N * sizeof(float));
-        memset(temp_result, 0, N * N * sizeof(float));
+        printf("Sparse: %lf seconds, %zu of %zu terms in CSR, peak %.1f MB\n",
+               t1 - t0, stats.sparse_terms, M, stats.peak_bytes / 1048576.0);
+        printf("Dense: %lf seconds, %.1f MB\n", t3 - t2, 7.0 * N * N * sizeof(float) / 1048576.0);
+        printf("Max difference: %e\n", max_diff);
     }
 
-    matrix_multiply(result, B, temp_result, N);
-    memcpy(result, temp_result, N * N * sizeof(float));
+    csr_destroy(A); free(sparse_result); free(dense_result); free(dense_A);
+    return !ok;
+}
+
+// Повтор того же обращения классическим умножением: время и расхождение
+// результата со Штрассеном max|X_s - X| / max|X|
+static void report_strassen_drift(const char *mode, const float *A, const float *inverseA,
+                                  size_t N, size_t M, float tol, size_t crossover,
+                                  struct matrix_workspace *ws)
+{
+    double t0 = wall_time();
+    double drift = bench_strassen_drift(mode, A, inverseA, N, M, tol, crossover, ws);
+    double t1 = wall_time();
 
-    free(Im); free(B); free(R); free(BA); free(current_power); free(temp_result);
+    if (!isnan(drift))
+        printf("Classical: %lf seconds (wall), Strassen drift: %e\n", t1 - t0, drift);
 }
 
-int main(void)
+int main(int argc, char *argv[])
 {
+    // Реализацию умножения можно задать флагом --backend=NAME или
+    // переменной окружения LAB7_BACKEND; по умолчанию выбирается лучшая
+    const char *backend_name = getenv("LAB7_BACKEND");
+    size_t batch_count = 0;
+    int bench_fixed = 0;
+    int bench_B = 0;
+    size_t strassen = 0;
+    const char *ooc_dir = NULL;
+    unsigned long long seed = time(NULL);
+    size_t tile = 1024;
+    int shards = 0;
+    int tune = 0;
+    const char *sparse_kind = NULL;
+    double sparse_param = 0;
+    float fill = 0.05f;
+    // Замер без диалога: --N=256,512 --M=10,20 задают сетку размеров
+    size_t bench_N[64], bench_M[64];
+    struct bench_options bench = { .backends = "all", .warmup = 1, .trials = 5,
+                                   .format = "text", .out = stdout };
+    const char *output = NULL;
+    const char *args[2] = { NULL, NULL };
+    int nargs = 0;
+
+    // Рабочий процесс matrix_invert_sharded: больше ничего не делает
+    if (argc > 1 && strncmp(argv[1], "--shard-worker=", 15) == 0)
+        return shard_worker_main(argv[1] + 15);
+
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--backend=", 10) == 0) {
+            backend_name = argv[i] + 10;
+        } else if (strncmp(argv[i], "--batch=", 8) == 0) {
+            batch_count = strtoull(argv[i] + 8, NULL, 10);
+        } else if (strncmp(argv[i], "--strassen=", 11) == 0) {
+            // Порог, начиная с которого умножение идёт по Штрассену
+            strassen = strtoull(argv[i] + 11, NULL, 10);
+        } else if (strncmp(argv[i], "--seed=", 7) == 0) {
+            seed = strtoull(argv[i] + 7, NULL, 10);
+        } else if (strncmp(argv[i], "--sparse=", 9) == 0) {
+            // --sparse=banded:W или --sparse=random:DENSITY
+            sparse_kind = argv[i] + 9;
+            const char *colon = strchr(sparse_kind, ':');
+            sparse_param = colon ? strtod(colon + 1, NULL) : 0;
+        } else if (strncmp(argv[i], "--fill=", 7) == 0) {
+            fill = strtof(argv[i] + 7, NULL);
+        } else if (strncmp(argv[i], "--ooc=", 6) == 0) {
+            ooc_dir = argv[i] + 6;
+        } else if (strncmp(argv[i], "--tile=", 7) == 0) {
+            tile = strtoull(argv[i] + 7, NULL, 10);
+        } else if (strncmp(argv[i], "--shards=", 9) == 0) {
+            // Число процессов; --shards=nodes — по одному на узел NUMA
+            shards = strcmp(argv[i] + 9, "nodes") == 0 ? shard_node_count()
+                                                        : atoi(argv[i] + 9);
+        } else if (strncmp(argv[i], "--N=", 4) == 0) {
+            bench.N_count = bench_parse_list(argv[i] + 4, bench_N, 64);
+        } else if (strncmp(argv[i], "--M=", 4) == 0) {
+            bench.M_count = bench_parse_list(argv[i] + 4, bench_M, 64);
+        } else if (strncmp(argv[i], "--backends=", 11) == 0) {
+            bench.backends = argv[i] + 11;
+        } else if (strncmp(argv[i], "--warmup=", 9) == 0) {
+            bench.warmup = strtoull(argv[i] + 9, NULL, 10);
+        } else if (strncmp(argv[i], "--trials=", 9) == 0) {
+            bench.trials = strtoull(argv[i] + 9, NULL, 10);
+        } else if (strncmp(argv[i], "--format=", 9) == 0) {
+            bench.format = argv[i] + 9;
+        } else if (strncmp(argv[i], "--output=", 9) == 0) {
+            output = argv[i] + 9;
+        } else if (strcmp(argv[i], "--tune") == 0) {
+            // Подобрать блокирование заново, даже если оно есть в кэше
+            tune = 1;
+        } else if (strcmp(argv[i], "--bench-B") == 0) {
+            bench_B = 1;
+        } else if (strcmp(argv[i], "--bench-fixed") == 0) {
+            bench_fixed = 1;
+        } else if (strcmp(argv[i], "--list-backends") == 0) {
+            backend_print(stdout);
+            return 0;
+        } else if (nargs < 2) {
+            args[nargs++] = argv[i];
+        }
+    }
+
+    if (!backend_init(backend_name)) {
+        fprintf(stderr, "Backend %s is unknown or not supported on this machine\n", backend_name);
+        backend_print(stderr);
+        return 1;
+    }
+    // При первом запуске на машине блокирование подбирается замерами
+    if (backend_current()->kernel)
+        gemm_autotune(backend_current()->kernel, tune);
+
+    const char *mode = args[0] ? args[0] : "series";
+    if (strcmp(mode, "series") != 0 && strcmp(mode, "doubling") != 0 &&
+        strcmp(mode, "newton") != 0) {
+        fprintf(stderr, "Unknown mode: %s (expected series, doubling or newton)\n", mode);
+        return 1;
+    }
+    // Для newton M — предельное число итераций, второй аргумент — порог невязки;
+    // для series с порогом M — предельное число членов ряда
+    float tol = args[1] ? strtof(args[1], NULL) : strcmp(mode, "newton") == 0 ? 1e-3f : 0;
+
+    if (bench.N_count > 0) {
+        if (strcmp(bench.format, "text") != 0 && strcmp(bench.format, "csv") != 0 &&
+            strcmp(bench.format, "json") != 0) {
+            fprintf(stderr, "Unknown format: %s (expected text, csv or json)\n", bench.format);
+            return 1;
+        }
+        if (bench.M_count == 0)
+            bench_M[bench.M_count++] = 10;
+        bench.mode = mode;
+        bench.tol = tol;
+        bench.Ns = bench_N;
+        bench.Ms = bench_M;
+        if (output && !(bench.out = fopen(output, "w"))) {
+            perror(output);
+            return 1;
+        }
+        bench.strassen = strassen;
+        matrix_set_strassen(strassen);
+        random_set_seed(seed);
+        int status = bench_run(&bench);
+        if (output)
+            fclose(bench.out);
+        return status;
+    }
+
     size_t N = 0, M = 0;
-    printf("Enter matrix size (N): ");
-    if (scanf("%zu", &N) == 0) return 0;
+    // В сравнении ядер размеры фиксированы, N не спрашивается
+    if (!bench_fixed) {
+        printf("Enter matrix size (N): ");
+        if (scanf("%zu", &N) == 0) return 0;
+    }
     printf("Enter number of iterations (M): ");
     if (scanf("%zu", &M) == 0) return 0;
 
-    srand(time(NULL));
+    printf("Backend: %s\n", backend_current()->name);
+
+    matrix_set_strassen(strassen);
+
+    // С тем же --seed матрицы совпадают при любом числе потоков
+    random_set_seed(seed);
+    printf("Seed: %llu\n", seed);
+    if (bench_fixed)
+        return run_fixed_bench(M);
+    if (bench_B)
+        return run_generate_B_bench(N);
+    if (batch_count > 0)
+        return run_batch(batch_count, N, M);
+    if (shards > 0)
+        return run_sharded(shards, N, M);
+    if (ooc_dir)
+        return run_ooc(ooc_dir, N, M, tile ? tile : 1024);
+    if (sparse_kind)
+        return run_sparse(strncmp(sparse_kind, "banded", 6) == 0 ? "banded" : "random",
+                          sparse_param, N, M, fill);
+
     float *A = create_random_matrix(N);
     float *inverseA = calloc(N * N, sizeof(float));
 
-    if (!A || !inverseA) return 1;
+    struct matrix_workspace *ws = workspace_create(N);
 
-    struct tms start, end;
-    clock_t clock_start = times(&start);
+    if (!A || !inverseA || !ws) return 1;
 
-    matrix_invert(A, inverseA, N, M);
+    float residual = 0;
+    struct perf_region region = {0};
+    struct perf_sample sample;
+    // Открытие счётчиков и калибровка TSC — не в замеренное время
+    perf_open(&region);
+    double cpu_start = (double)clock() / CLOCKS_PER_SEC;
+    perf_begin(&region);
+    size_t iterations = bench_solve(mode, A, inverseA, N, M, tol, &residual, ws);
+    perf_end(&region, &sample);
+    double cpu_end = (double)clock() / CLOCKS_PER_SEC;
+    perf_close(&region);
 
-    clock_t clock_end = times(&end);
+    // Процессорное время суммируется по потокам, поэтому главное — wall
+    printf("Elapsed Time: %lf seconds (wall), %lf seconds (CPU)\n",
+           sample.seconds, cpu_end - cpu_start);
+    perf_print(stdout, "Counters (main thread)", &sample);
 
-    double elapsed_time = (double)(end.tms_utime - start.tms_utime) / sysconf(_SC_CLK_TCK);
+    if (strcmp(mode, "newton") == 0)
+        printf("Iterations: %zu, ||I - A*X||: %e\n", iterations, residual);
+    else if (strcmp(mode, "series") == 0 && tol > 0)
+        printf("Terms: %zu, ||I - X*A|| (estimate): %e\n", iterations, residual);
 
-    printf("Elapsed Time: %lf seconds\n", elapsed_time);
-    
     printf("A: %f, %f, %f\n", A[0], A[1], A[N]);
 
     printf("Inverse A: %f, %f, %f\n", inverseA[0], inverseA[1], inverseA[N]);
 
+    if (strassen) {
+        printf("Strassen (crossover %zu): %lf seconds (wall)\n", strassen, sample.seconds);
+        report_strassen_drift(mode, A, inverseA, N, M, tol, strassen, ws);
+    }
+
+    workspace_destroy(ws);
     free(A);
     free(inverseA);
     return 0;
@@ -0,0 +1,573 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <sys/mman.h>
+
+#include "matrix.h"
+#include "gemm.h"
+
+#ifdef GEMM_X86
+#include <immintrin.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#else
+static int omp_get_max_threads(void) { return 1; }
+static int omp_get_thread_num(void) { return 0; }
+#endif
+
+float *create_identity_matrix(size_t N)
+{
+    float *Im = matrix_alloc(N * N);
+    if (!Im) return NULL;
+
+    // Строки заполняются теми же потоками и в том же порядке, что и в
+    // умножениях, чтобы страницы оказались на их узлах NUMA
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < N; ++i) {
+        memset(Im + i * N, 0, N * sizeof(float));
+        Im[i * N + i] = 1.0f;
+    }
+
+    return Im;
+}
+
+// Транспонирование идёт блоками TRANSPOSE_BLOCK x TRANSPOSE_BLOCK: строки
+// A блока остаются в кэше, пока из них собираются столбцы B
+#define TRANSPOSE_BLOCK 64
+
+#ifdef GEMM_X86
+// B[i][j] = A[j][i] / s для блока 8 x 8: восемь загрузок строк A,
+// перестановки в регистрах и восемь записей строк B
+__attribute__((target("avx")))
+static void transpose8_scale(const float *A, size_t lda, float *B, size_t ldb, float s)
+{
+    __m256 r0 = _mm256_loadu_ps(A), r1 = _mm256_loadu_ps(A + lda);
+    __m256 r2 = _mm256_loadu_ps(A + 2 * lda), r3 = _mm256_loadu_ps(A + 3 * lda);
+    __m256 r4 = _mm256_loadu_ps(A + 4 * lda), r5 = _mm256_loadu_ps(A + 5 * lda);
+    __m256 r6 = _mm256_loadu_ps(A + 6 * lda), r7 = _mm256_loadu_ps(A + 7 * lda);
+    __m256 scale = _mm256_set1_ps(s);
+
+    __m256 t0 = _mm256_unpacklo_ps(r0, r1), t1 = _mm256_unpackhi_ps(r0, r1);
+    __m256 t2 = _mm256_unpacklo_ps(r2, r3), t3 = _mm256_unpackhi_ps(r2, r3);
+    __m256 t4 = _mm256_unpacklo_ps(r4, r5), t5 = _mm256_unpackhi_ps(r4, r5);
+    __m256 t6 = _mm256_unpacklo_ps(r6, r7), t7 = _mm256_unpackhi_ps(r6, r7);
+
+    r0 = _mm256_shuffle_ps(t0, t2, 0x44); r1 = _mm256_shuffle_ps(t0, t2, 0xee);
+    r2 = _mm256_shuffle_ps(t1, t3, 0x44); r3 = _mm256_shuffle_ps(t1, t3, 0xee);
+    r4 = _mm256_shuffle_ps(t4, t6, 0x44); r5 = _mm256_shuffle_ps(t4, t6, 0xee);
+    r6 = _mm256_shuffle_ps(t5, t7, 0x44); r7 = _mm256_shuffle_ps(t5, t7, 0xee);
+
+    _mm256_storeu_ps(B, _mm256_div_ps(_mm256_permute2f128_ps(r0, r4, 0x20), scale));
+    _mm256_storeu_ps(B + ldb, _mm256_div_ps(_mm256_permute2f128_ps(r1, r5, 0x20), scale));
+    _mm256_storeu_ps(B + 2 * ldb, _mm256_div_ps(_mm256_permute2f128_ps(r2, r6, 0x20), scale));
+    _mm256_storeu_ps(B + 3 * ldb, _mm256_div_ps(_mm256_permute2f128_ps(r3, r7, 0x20), scale));
+    _mm256_storeu_ps(B + 4 * ldb, _mm256_div_ps(_mm256_permute2f128_ps(r0, r4, 0x31), scale));
+    _mm256_storeu_ps(B + 5 * ldb, _mm256_div_ps(_mm256_permute2f128_ps(r1, r5, 0x31), scale));
+    _mm256_storeu_ps(B + 6 * ldb, _mm256_div_ps(_mm256_permute2f128_ps(r2, r6, 0x31), scale));
+    _mm256_storeu_ps(B + 7 * ldb, _mm256_div_ps(_mm256_permute2f128_ps(r3, r7, 0x31), scale));
+}
+#endif
+
+// Строки B с i0 по i1: B = A^T / s, поблочно
+static void transpose_scale_rows(const float *A, float *B, size_t N,
+                                 size_t i0, size_t i1, float s, int avx)
+{
+    for (size_t j0 = 0; j0 < N; j0 += TRANSPOSE_BLOCK) {
+        size_t j1 = N - j0 < TRANSPOSE_BLOCK ? N : j0 + TRANSPOSE_BLOCK;
+        size_t i = i0;
+
+#ifdef GEMM_X86
+        if (avx) {
+            for (; i + 8 <= i1; i += 8) {
+                size_t j = j0;
+                for (; j + 8 <= j1; j += 8)
+                    transpose8_scale(A + j * N + i, N, B + i * N + j, N, s);
+                for (size_t ii = i; ii < i + 8; ++ii)
+                    for (size_t jj = j; jj < j1; ++jj)
+                        B[ii * N + jj] = A[jj * N + ii] / s;
+            }
+        }
+#else
+        (void)avx;
+#endif
+        for (; i < i1; ++i)
+            for (size_t j = j0; j < j1; ++j)
+                B[i * N + j] = A[j * N + i] / s;
+    }
+}
+
+size_t generate_B_sums_size(size_t N)
+{
+    return (2 + (size_t)omp_get_max_threads()) * N;
+}
+
+int generate_B_into(const float *A, float *B, float *sums, size_t N)
+{
+    float max_row_sum = __FLT_MIN__;
+    float max_col_sum = __FLT_MIN__;
+
+    float *row_sums = sums;
+    float *col_sums = sums + N;
+    memset(sums, 0, 2 * N * sizeof(float));
+
+    // У каждого потока свои частичные суммы столбцов по его строкам
+    // (в хвосте sums); затем они сворачиваются, тоже по кускам столбцов
+    int nthreads = N >= TRANSPOSE_BLOCK ? omp_get_max_threads() : 1;
+    float *partials = nthreads > 1 ? sums + 2 * N : NULL;
+    if (partials)
+        memset(partials, 0, (size_t)nthreads * N * sizeof(float));
+
+    #pragma omp parallel num_threads(nthreads)
+    {
+        float *cols = partials ? partials + (size_t)omp_get_thread_num() * N : col_sums;
+
+        #pragma omp for schedule(static)
+        for (size_t i = 0; i < N; ++i) {
+            const float *a = A + i * N;
+            float row_sum = 0;
+            #pragma omp simd reduction(+:row_sum)
+            for (size_t j = 0; j < N; ++j) {
+                row_sum += a[j];
+                cols[j] += a[j];
+            }
+            row_sums[i] = row_sum;
+        }
+
+        if (partials) {
+            #pragma omp for schedule(static)
+            for (size_t j = 0; j < N; ++j) {
+                float c = 0;
+                for (int t = 0; t < nthreads; ++t)
+                    c += partials[(size_t)t * N + j];
+                col_sums[j] = c;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < N; ++i) {
+        if (row_sums[i] > max_row_sum) max_row_sum = row_sums[i];
+        if (col_sums[i] > max_col_sum) max_col_sum = col_sums[i];
+    }
+
+    float scaling_factor = max_row_sum * max_col_sum;
+    if (scaling_factor == 0) return 0;
+
+#ifdef GEMM_X86
+    int avx = __builtin_cpu_supports("avx");
+#else
+    int avx = 0;
+#endif
+
+    // Полосы строк B раздаются потокам статически: первое касание
+    // страниц B — тем же потокам, что потом читают их в умножениях
+    size_t strips = (N + TRANSPOSE_BLOCK - 1) / TRANSPOSE_BLOCK;
+    #pragma omp parallel for schedule(static)
+    for (size_t b = 0; b < strips; ++b) {
+        size_t i0 = b * TRANSPOSE_BLOCK;
+        size_t i1 = N - i0 < TRANSPOSE_BLOCK ? N : i0 + TRANSPOSE_BLOCK;
+        transpose_scale_rows(A, B, N, i0, i1, scaling_factor, avx);
+    }
+
+    return 1;
+}
+
+float *generate_B(const float *A, size_t N)
+{
+    float *B = matrix_alloc(N * N);
+    float *sums = malloc(generate_B_sums_size(N) * sizeof(float));
+
+    if (!B || !sums || !generate_B_into(A, B, sums, N)) {
+        free(B); free(sums);
+        return NULL;
+    }
+
+    free(sums);
+    return B;
+}
+
+float *create_random_matrix(size_t N)
+{
+    float *M = matrix_alloc(N * N);
+    if (!M) return NULL;
+
+    random_fill(M, 0, N * N);
+    return M;
+}
+
+static size_t strassen_crossover;
+// Временные блоки Штрассена: растут до нужного размера и не освобождаются
+static float *strassen_work;
+static size_t strassen_work_count;
+
+void matrix_set_strassen(size_t crossover)
+{
+    strassen_crossover = crossover;
+}
+
+static int strassen_active(size_t N)
+{
+    return strassen_crossover && N >= strassen_crossover;
+}
+
+// Эпилог для Штрассена применяется отдельным проходом. Для accumulate
+// произведение считается в запасной блок за временными.
+static void multiply_strassen(const float *A, const float *B, float *C, size_t N,
+                              const struct gemm_epilogue *ep)
+{
+    int accumulate = ep && ep->accumulate && !ep->negate;
+    size_t need = strassen_work_size(N, strassen_crossover) + (accumulate ? N * N : 0);
+
+    if (need > strassen_work_count) {
+        free(strassen_work);
+        strassen_work = matrix_alloc(need);
+        strassen_work_count = strassen_work ? need : 0;
+        if (!strassen_work) {
+            backend_current()->sgemm(N, N, N, A, N, B, N, C, N, ep);
+            return;
+        }
+    }
+
+    float *P = accumulate ? strassen_work : C;
+    strassen_multiply(backend_current(), strassen_crossover, N, A, N, B, N, P, N,
+                      accumulate ? strassen_work + N * N : strassen_work);
+    if (!ep) return;
+
+    for (size_t i = 0; i < N; ++i)
+        for (size_t j = 0; j < N; ++j) {
+            float c = P[i * N + j];
+            if (ep->negate)
+                c = (i == j ? ep->diag : 0.0f) - c;
+            else if (accumulate)
+                c += C[i * N + j];
+            C[i * N + j] = c;
+            if (ep->C2)
+                ep->C2[i * ep->ldc2 + j] += c;
+            if (ep->norm2)
+                *ep->norm2 += (double)c * c;
+        }
+}
+
+void matrix_multiply(const float *A, const float *B, float *C, size_t N)
+{
+    matrix_multiply_ex(A, B, C, N, NULL);
+}
+
+void matrix_multiply_ex(const float *A, const float *B, float *C, size_t N,
+                        const struct gemm_epilogue *ep)
+{
+    if (strassen_active(N))
+        multiply_strassen(A, B, C, N, ep);
+    else
+        backend_current()->sgemm(N, N, N, A, N, B, N, C, N, ep);
+}
+
+void matrix_subtract(const float *A, const float *B, float *C, size_t N)
+{
+    for (size_t i = 0; i < N * N; ++i)
+        C[i] = A[i] - B[i];
+}
+
+void matrix_add(const float *A, const float *B, float *C, size_t N)
+{
+    for (size_t i = 0; i < N * N; ++i)
+        C[i] = A[i] + B[i];
+}
+
+#define HUGE_PAGE_SIZE (2u << 20)
+
+float *matrix_alloc(size_t count)
+{
+    size_t bytes = count * sizeof(float);
+    size_t align = bytes >= HUGE_PAGE_SIZE ? HUGE_PAGE_SIZE : 64;
+    void *p = NULL;
+
+    bytes = (bytes + align - 1) & ~(align - 1);
+    if (posix_memalign(&p, align, bytes) != 0)
+        return NULL;
+#ifdef MADV_HUGEPAGE
+    if (align == HUGE_PAGE_SIZE)
+        madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+    return p;
+}
+
+struct matrix_workspace {
+    size_t N;
+    float *B;
+    float *R;
+    float *power;
+    float *next;
+    float *sum;
+    float *sums;                // суммы строк и столбцов для generate_B_into
+    float *packed_R;            // R, упакованная ядром packed_kernel
+    size_t packed_size;
+    const struct gemm_kernel *packed_kernel;
+};
+
+struct matrix_workspace *workspace_create(size_t N)
+{
+    struct matrix_workspace *ws = calloc(1, sizeof(*ws));
+    if (!ws) return NULL;
+
+    ws->N = N;
+    ws->B = matrix_alloc(N * N);
+    ws->R = matrix_alloc(N * N);
+    ws->power = matrix_alloc(N * N);
+    ws->next = matrix_alloc(N * N);
+    ws->sum = matrix_alloc(N * N);
+    ws->sums = matrix_alloc(generate_B_sums_size(N));
+
+    if (!ws->B || !ws->R || !ws->power || !ws->next || !ws->sum || !ws->sums) {
+        workspace_destroy(ws);
+        return NULL;
+    }
+
+    return ws;
+}
+
+void workspace_destroy(struct matrix_workspace *ws)
+{
+    if (!ws) return;
+
+    free(ws->B); free(ws->R); free(ws->power);
+    free(ws->next); free(ws->sum); free(ws->sums); free(ws->packed_R);
+    free(ws);
+}
+
+// Упаковывает R для текущего ядра, чтобы умножения на R не паковали её заново.
+// Буфер переиспользуется, пока хватает его размера.
+static void workspace_pack_R(struct matrix_workspace *ws)
+{
+    const struct gemm_kernel *kern = backend_current()->kernel;
+    size_t N = ws->N;
+
+    ws->packed_kernel = NULL;
+    // Штрассен работает с обычной раскладкой: упаковка ему не нужна
+    if (!kern || strassen_active(N)) return;
+
+    size_t size = gemm_packed_b_size(kern, N, N);
+    if (size > ws->packed_size) {
+        free(ws->packed_R);
+        ws->packed_R = matrix_alloc(size);
+        ws->packed_size = ws->packed_R ? size : 0;
+        if (!ws->packed_R) return;
+    }
+
+    gemm_pack_b(kern, N, N, ws->R, N, ws->packed_R);
+    ws->packed_kernel = kern;
+}
+
+// C = X * R с эпилогом ep
+static void multiply_by_R(struct matrix_workspace *ws, const float *X, float *C,
+                          const struct gemm_epilogue *ep)
+{
+    size_t N = ws->N;
+
+    if (ws->packed_kernel == backend_current()->kernel && ws->packed_kernel)
+        gemm_sgemm_packed(ws->packed_kernel, N, N, N, X, N, ws->packed_R, C, N, ep);
+    else
+        matrix_multiply_ex(X, ws->R, C, N, ep);
+}
+
+// Общее начало рядов: B = A^T / (||A||_1 ||A||_inf), R = I - BA;
+// r_norm2 != NULL — туда же ||R||_F^2
+static int workspace_prepare(struct matrix_workspace *ws, const float *A,
+                             double *r_norm2)
+{
+    size_t N = ws->N;
+
+    if (!generate_B_into(A, ws->B, ws->sums, N))
+        return 0;
+
+    // R = I - B * A одним проходом
+    struct gemm_epilogue identity_minus = { .negate = 1, .diag = 1.0f, .norm2 = r_norm2 };
+    matrix_multiply_ex(ws->B, A, ws->R, N, &identity_minus);
+    workspace_pack_R(ws);
+    return 1;
+}
+
+static int use_fixed = 1;
+
+void matrix_set_fixed(int enabled)
+{
+    use_fixed = enabled;
+}
+
+void matrix_invert(const float *A, float *result, size_t N, size_t M,
+                   struct matrix_workspace *ws)
+{
+    matrix_invert_tol(A, result, N, M, 0, NULL, ws);
+}
+
+size_t matrix_invert_tol(const float *A, float *result, size_t N, size_t M,
+                         float tol, float *residual, struct matrix_workspace *ws)
+{
+    // Специализированные ядра норму не отслеживают и не пользуются
+    // выбранной реализацией умножения; при отказе — общий путь
+    if (tol <= 0 && use_fixed && backend_is_auto() && matrix_invert_fixed(A, result, N, M))
+        return M;
+
+    struct matrix_workspace *own = NULL;
+    if (!ws) ws = own = workspace_create(N);
+    if (!ws || ws->N != N) return 0;
+
+    // ||R^k||_F считается эпилогом того же умножения, что даёт R^k
+    double norm2 = 0;
+    double *track = tol > 0 ? &norm2 : NULL;
+    // ||BA||_2 <= 1, поэтому ||S||_F >= 1, и слагаемое с нормой меньше
+    // FLT_EPSILON уже не меняет сумму
+    float limit = tol > FLT_EPSILON ? tol : FLT_EPSILON;
+    float norm = 0, prev_norm = 0;
+    size_t terms = 0;
+
+    if (workspace_prepare(ws, A, track)) {
+        memcpy(ws->sum, ws->R, N * N * sizeof(float));
+        for (size_t i = 0; i < N; ++i)
+            ws->sum[i * N + i] += 1.0f;
+        terms = 1;
+        norm = sqrtf((float)norm2);
+
+        // Степени R чередуются в power/next обменом указателей, а сумма
+        // пополняется эпилогом умножения: один проход по памяти на шаг
+        struct gemm_epilogue add_to_sum = { .C2 = ws->sum, .ldc2 = N, .norm2 = track };
+        const float *current_power = ws->R;
+        float *out = ws->power;
+
+        for (size_t i = 2; i <= M && !(track && norm < limit); ++i) {
+            norm2 = 0;
+            multiply_by_R(ws, current_power, out, &add_to_sum);
+            terms = i;
+            prev_norm = norm;
+            norm = sqrtf((float)norm2);
+
+            current_power = out;
+            out = out == ws->power ? ws->next : ws->power;
+        }
+
+        matrix_multiply(ws->sum, ws->B, result, N);
+    }
+
+    // X A = S_k (I - R) = I - R^(k+1): невязка — норма следующего члена,
+    // она оценивается по отношению двух последних норм
+    if (track && residual && terms)
+        *residual = terms > 1 && prev_norm > 0 ? norm * (norm / prev_norm) : norm * norm;
+
+    workspace_destroy(own);
+    return terms;
+}
+
+// Тот же ряд I + R + ... + R^M, но вычисленный удвоением:
+// S_2t = S_t + R^t * S_t, R^2t = R^t * R^t, а для нечётного числа членов
+// S_t+1 = S_t + R^t. Вместо M - 1 умножений выходит около 2 * log2(M).
+void matrix_invert_doubling(const float *A, float *result, size_t N, size_t M,
+                            struct matrix_workspace *ws)
+{
+    struct matrix_workspace *own = NULL;
+    if (!ws) ws = own = workspace_create(N);
+    if (!ws || ws->N != N) return;
+
+    if (!workspace_prepare(ws, A, NULL)) {
+        workspace_destroy(own);
+        return;
+    }
+
+    // Число членов ряда; при M < 1 исходная версия всё равно берёт I + R
+    size_t terms = M < 1 ? 2 : M + 1;
+    int top = 0;
+    while ((terms >> (top + 1)) != 0)
+        ++top;
+
+    // S_1 = I, R^1 = R
+    float *S = ws->sum, *power = ws->power, *temp_result = ws->next;
+    memset(S, 0, N * N * sizeof(float));
+    for (size_t i = 0; i < N; ++i)
+        S[i * N + i] = 1.0f;
+    memcpy(power, ws->R, N * N * sizeof(float));
+
+    for (int bit = top - 1; bit >= 0; --bit) {
+        int odd = (terms >> bit) & 1;
+        int last = bit == 0;
+
+        // S += R^t * S: S одновременно правый множитель и приёмник эпилога
+        struct gemm_epilogue add_to_S = { .C2 = S, .ldc2 = N };
+        matrix_multiply_ex(power, S, temp_result, N, &add_to_S);
+
+        if (!last || odd) {
+            matrix_multiply(power, power, temp_result, N);
+            float *swap = power; power = temp_result; temp_result = swap;
+        }
+
+        if (odd) {
+            matrix_add(S, power, S, N);
+            if (!last) {
+                multiply_by_R(ws, power, temp_result, NULL);
+                float *swap = power; power = temp_result; temp_result = swap;
+            }
+        }
+    }
+
+    matrix_multiply(S, ws->B, result, N);
+
+    workspace_destroy(own);
+}
+
+// Итерация Ньютона–Шульца X_k+1 = X_k (2I - A X_k) с тем же начальным
+// приближением X_0 = B. Сходится квадратично; останавливается, когда
+// ||I - A X_k||_F < tol или невязка перестала убывать (предел точности float),
+// но не более чем через max_iter итераций. Возвращает число итераций.
+size_t matrix_invert_newton(const float *A, float *result, size_t N,
+                            size_t max_iter, float tol, float *residual,
+                            struct matrix_workspace *ws)
+{
+    struct matrix_workspace *own = NULL;
+    if (!ws) ws = own = workspace_create(N);
+    if (!ws || ws->N != N) return 0;
+
+    float *X = ws->B, *AX = ws->power, *X_next = ws->next;
+    if (!generate_B_into(A, X, ws->sums, N)) {
+        workspace_destroy(own);
+        return 0;
+    }
+
+    double prev_res = 0;
+    float res = 0;
+    size_t it = 0;
+    // Сразу E = 2I - A X; невязка I - A X = E - I
+    struct gemm_epilogue two_minus = { .negate = 1, .diag = 2.0f };
+
+    for (;; ++it) {
+        matrix_multiply_ex(A, X, AX, N, &two_minus);
+
+        double sum = 0;
+        for (size_t i = 0; i < N; ++i)
+            for (size_t j = 0; j < N; ++j) {
+                double e = AX[i * N + j] - (i == j ? 1.0 : 0.0);
+                sum += e * e;
+            }
+        res = (float)sqrt(sum);
+
+        if (it > 0 && res >= prev_res) {
+            // Шаг ухудшил приближение — возвращаемся к предыдущему
+            float *swap = X; X = X_next; X_next = swap;
+            res = (float)prev_res;
+            --it;
+            break;
+        }
+        if (res < tol || it == max_iter)
+            break;
+        prev_res = res;
+
+        matrix_multiply(X, AX, X_next, N);
+        float *swap = X; X = X_next; X_next = swap;
+    }
+
+    memcpy(result, X, N * N * sizeof(float));
+    if (residual)
+        *residual = res;
+
+    workspace_destroy(own);
+    return it;
+}
@@ -0,0 +1,185 @@
+#ifndef LAB7_MATRIX_H
+#define LAB7_MATRIX_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "gemm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// C = A * B (m x k на k x n), построчное хранение; ep — эпилог или NULL
+typedef void (*sgemm_fn)(size_t m, size_t n, size_t k,
+                         const float *A, size_t lda,
+                         const float *B, size_t ldb,
+                         float *C, size_t ldc, const struct gemm_epilogue *ep);
+
+struct matrix_backend {
+    const char *name;
+    int (*available)(void);
+    sgemm_fn sgemm;
+    // Ядро встроенного движка (NULL для BLAS): через него решатели
+    // переиспользуют упакованный правый множитель
+    const struct gemm_kernel *kernel;
+};
+
+// Выбор реализации умножения. name == NULL или "auto" — самая быстрая
+// из доступных на этом процессоре. Возвращает NULL, если name неизвестно
+// или недоступно.
+const struct matrix_backend *backend_init(const char *name);
+// Текущая реализация; при первом вызове без backend_init выбирается "auto"
+const struct matrix_backend *backend_current(void);
+// 1, если текущая реализация выбрана как "auto", а не названа явно
+int backend_is_auto(void);
+// i-я реализация из списка (NULL за концом списка), для перебора всех
+const struct matrix_backend *backend_at(size_t i);
+void backend_print(FILE *out);
+
+// Выделение памяти под count чисел float с выравниванием на 64 байта;
+// большие буферы выравниваются на 2 МБ и помечаются для huge pages.
+// Освобождается обычным free.
+float *matrix_alloc(size_t count);
+
+// Рабочая область решателей: все буферы N x N выделяются один раз, и
+// повторные обращения одного размера не обращаются к куче
+struct matrix_workspace;
+
+struct matrix_workspace *workspace_create(size_t N);
+void workspace_destroy(struct matrix_workspace *ws);
+
+// Случайные числа в [0, 1) от генератора со счётчиком: out[e] — число
+// с номером first + e. Одинаковы при любом числе потоков OpenMP.
+void random_set_seed(unsigned long long seed);
+void random_fill(float *out, unsigned long long first, size_t count);
+
+// Матрицы выделяются matrix_alloc и заполняются параллельно: страницы
+// достаются тем потокам, которые потом с ними работают
+float *create_identity_matrix(size_t N);
+float *create_random_matrix(size_t N);
+float *generate_B(const float *A, size_t N);
+// То же в готовый буфер B без выделения памяти; sums — не меньше
+// generate_B_sums_size(N) чисел: суммы строк и столбцов и частичные суммы
+// столбцов каждого потока OpenMP. Возвращает 0 при ошибке.
+size_t generate_B_sums_size(size_t N);
+int generate_B_into(const float *A, float *B, float *sums, size_t N);
+
+void matrix_multiply(const float *A, const float *B, float *C, size_t N);
+// C = A * B с эпилогом (см. gemm.h)
+void matrix_multiply_ex(const float *A, const float *B, float *C, size_t N,
+                        const struct gemm_epilogue *ep);
+// Умножение Штрассена–Винограда поверх текущей реализации для N >= crossover:
+// блоки делятся пополам, пока не станут меньше crossover, а нечётная
+// строка и столбец отщепляются. 0 — выключено (по умолчанию).
+void matrix_set_strassen(size_t crossover);
+// Размер временных блоков (в числах float) для strassen_multiply
+size_t strassen_work_size(size_t N, size_t crossover);
+void strassen_multiply(const struct matrix_backend *be, size_t crossover, size_t n,
+                       const float *A, size_t lda, const float *B, size_t ldb,
+                       float *C, size_t ldc, float *work);
+void matrix_subtract(const float *A, const float *B, float *C, size_t N);
+void matrix_add(const float *A, const float *B, float *C, size_t N);
+
+// ws — рабочая область размера N или NULL (тогда она создаётся на время вызова)
+void matrix_invert(const float *A, float *result, size_t N, size_t M,
+                   struct matrix_workspace *ws);
+// То же с ранней остановкой: ||R^k||_F считается эпилогом умножения, и ряд
+// обрывается, как только очередной член меньше tol (или FLT_EPSILON).
+// Возвращает число членов; residual получает оценку ||I - XA||_F.
+// tol <= 0 — ровно M членов без отслеживания, как matrix_invert.
+size_t matrix_invert_tol(const float *A, float *result, size_t N, size_t M,
+                         float tol, float *residual, struct matrix_workspace *ws);
+void matrix_invert_doubling(const float *A, float *result, size_t N, size_t M,
+                            struct matrix_workspace *ws);
+// Обращение count матриц N x N, лежащих подряд в As, тем же рядом из M
+// членов. Рассчитано на много маленьких матриц: они обрабатываются
+// группами в SIMD-раскладке по потокам OpenMP, а N со специализацией —
+// ядрами matrix_invert_fixed. Возвращает 0 при нехватке памяти.
+int matrix_invert_batched(const float *As, float *results, size_t count,
+                          size_t N, size_t M);
+
+// Обращение вне памяти тем же рядом: матрицы лежат в файлах каталога dir
+// потайлово (тайлы tile x tile, края дополнены нулями) и отображаются
+// через mmap, так что в памяти держится лишь один тайл результата.
+// A читается из dir/A.bin, результат пишется в dir/X.bin.
+// Возвращает 0 при ошибке ввода-вывода.
+int matrix_invert_ooc(const char *dir, size_t N, size_t M, size_t tile);
+// Случайная матрица в dir/A.bin в той же раскладке
+int ooc_create_random(const char *dir, size_t N, size_t tile);
+// Чтение dir/name в обычную раскладку N x N
+int ooc_load(const char *dir, const char *name, float *M, size_t N, size_t tile);
+
+// То же обращение рядом в workers процессах, каждый закреплён за своим
+// узлом NUMA и считает свой блок строк; данные — в общей памяти POSIX.
+// Процессы запускаются из /proc/self/exe с флагом --shard-worker=ARG,
+// который программа должна передать в shard_worker_main.
+// Возвращает 0, если процессы не удалось запустить или один из них упал.
+int matrix_invert_sharded(const float *A, float *result, size_t N, size_t M, int workers);
+int shard_worker_main(const char *arg);
+// Число узлов NUMA (не меньше 1)
+int shard_node_count(void);
+
+// Разреженная матрица n x n в формате CSR; столбцы внутри строки
+// могут идти в любом порядке
+struct csr_matrix {
+    size_t n;
+    size_t nnz, cap;
+    size_t *row_ptr;    // n + 1
+    unsigned int *col;
+    float *val;
+};
+
+struct csr_matrix *csr_create(size_t n, size_t cap);
+void csr_destroy(struct csr_matrix *m);
+// Память под матрицу в байтах
+size_t csr_bytes(const struct csr_matrix *m);
+void csr_to_dense(const struct csr_matrix *m, float *dense);
+// Генераторы: лента полуширины bandwidth и около density * N случайных
+// ненулей в строке; диагональ увеличена на 1
+struct csr_matrix *csr_banded(size_t N, size_t bandwidth);
+struct csr_matrix *csr_random(size_t N, float density);
+
+// C = X * Y и C = X + alpha * Y; C не должна совпадать с X и Y.
+// Возвращают 0 при нехватке памяти.
+int sparse_multiply(const struct csr_matrix *X, const struct csr_matrix *Y,
+                    struct csr_matrix *C);
+int sparse_add(const struct csr_matrix *X, const struct csr_matrix *Y, float alpha,
+               struct csr_matrix *C);
+// C = X * Y в плотную C
+void sparse_multiply_dense(const struct csr_matrix *X, const struct csr_matrix *Y,
+                           float *C);
+// C = X * Y для плотной X и разреженной Y; sum != NULL — ещё sum += C
+void dense_multiply_sparse(const float *X, const struct csr_matrix *Y, float *C,
+                           float *sum);
+
+struct sparse_stats {
+    size_t sparse_terms;    // сколько членов ряда посчитано в CSR
+    size_t peak_bytes;      // наибольший объём живых матриц
+};
+
+// Тот же ряд из M членов для разреженной A. Степени R остаются в CSR,
+// пока их заполнение не больше max_density * N^2; дальше степень и сумма
+// плотные, а R остаётся разреженной, если сама проходит тот же порог.
+// Возвращает 0 при ошибке.
+int matrix_invert_sparse(const struct csr_matrix *A, float *result, size_t M,
+                         float max_density, struct sparse_stats *stats);
+
+size_t matrix_invert_newton(const float *A, float *result, size_t N,
+                            size_t max_iter, float tol, float *residual,
+                            struct matrix_workspace *ws);
+
+// Ядра для N = 4, 8, 16, 32, развёрнутые при компиляции (fixed.cpp).
+// Возвращает 0, если для такого N специализации нет или масштаб B
+// нулевой (тогда result не меняется и годится общий путь).
+int matrix_invert_fixed(const float *A, float *result, size_t N, size_t M);
+// matrix_invert сам передаёт подходящие N в matrix_invert_fixed, если
+// реализация умножения выбрана как "auto": явно названная замеряется
+// без подмены. enabled == 0 оставляет только общий путь (для сравнения).
+void matrix_set_fixed(int enabled);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
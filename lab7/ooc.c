@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "matrix.h"
+
+// Матрица в файле в потайловой раскладке: nt x nt тайлов T x T идут
+// построчно, внутри тайла — построчное хранение. Края дополнены нулями
+// до кратного T размера, поэтому умножение всегда идёт целыми тайлами.
+struct ooc_matrix {
+    float *data;
+    size_t bytes;
+    size_t N, T, nt;
+};
+
+static int ooc_map(struct ooc_matrix *m, const char *dir, const char *name,
+                   size_t N, size_t T, int create)
+{
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+
+    m->N = N;
+    m->T = T;
+    m->nt = (N + T - 1) / T;
+    m->bytes = m->nt * m->nt * T * T * sizeof(float);
+
+    int fd = open(path, create ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR, 0644);
+    if (fd < 0)
+        return 0;
+    // Новый файл разрежен: не записанные тайлы читаются нулями
+    if (create && ftruncate(fd, (off_t)m->bytes) != 0) {
+        close(fd);
+        return 0;
+    }
+
+    m->data = mmap(NULL, m->bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (m->data == MAP_FAILED) {
+        m->data = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+static void ooc_unmap(struct ooc_matrix *m)
+{
+    if (m->data)
+        munmap(m->data, m->bytes);
+    m->data = NULL;
+}
+
+static float *ooc_tile(const struct ooc_matrix *m, size_t ti, size_t tj)
+{
+    return m->data + (ti * m->nt + tj) * m->T * m->T;
+}
+
+// Подсказка ядру про один тайл: WILLNEED запускает асинхронное чтение,
+// пока считается текущий тайл; DONTNEED отпускает прочитанные страницы.
+// Тайл не обязан начинаться на границе страницы, поэтому диапазон
+// расширяется до целых страниц: отображение общее, и страницы соседей
+// при DONTNEED не теряются, а просто читаются заново.
+static void ooc_advise(const struct ooc_matrix *m, size_t ti, size_t tj, int advice)
+{
+    static int warned = 0;
+
+    if (ti >= m->nt || tj >= m->nt)
+        return;
+
+    uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t begin = (uintptr_t)ooc_tile(m, ti, tj);
+    uintptr_t end = begin + m->T * m->T * sizeof(float);
+    begin &= ~(page - 1);
+    end = (end + page - 1) & ~(page - 1);
+
+    if (madvise((void *)begin, end - begin, advice) != 0 && !warned) {
+        warned = 1;
+        perror("madvise");
+    }
+}
+
+// C = X * Y по тайлам. negate — C = I - X * Y; sum != NULL — ещё sum += C.
+// Тайл C копится в acc в памяти, и в файл пишется один раз.
+static void ooc_multiply(const struct ooc_matrix *X, const struct ooc_matrix *Y,
+                         struct ooc_matrix *C, float *acc, int negate,
+                         struct ooc_matrix *sum)
+{
+    const struct matrix_backend *be = backend_current();
+    const struct gemm_epilogue accumulate = { .accumulate = 1 };
+    size_t nt = C->nt, T = C->T;
+
+    for (size_t ti = 0; ti < nt; ++ti) {
+        for (size_t tj = 0; tj < nt; ++tj) {
+            for (size_t tk = 0; tk < nt; ++tk) {
+                // Следующая пара тайлов читается, пока считается текущая
+                if (tk + 1 < nt) {
+                    ooc_advise(X, ti, tk + 1, MADV_WILLNEED);
+                    ooc_advise(Y, tk + 1, tj, MADV_WILLNEED);
+                } else {
+                    ooc_advise(X, ti, 0, MADV_WILLNEED);
+                    ooc_advise(Y, 0, tj + 1, MADV_WILLNEED);
+                }
+
+                be->sgemm(T, T, T, ooc_tile(X, ti, tk), T, ooc_tile(Y, tk, tj), T,
+                          acc, T, tk ? &accumulate : NULL);
+            }
+
+            float *c = ooc_tile(C, ti, tj);
+            float *s = sum ? ooc_tile(sum, ti, tj) : NULL;
+
+            for (size_t i = 0; i < T; ++i)
+                for (size_t j = 0; j < T; ++j) {
+                    float v = acc[i * T + j];
+                    if (negate) {
+                        size_t gi = ti * T + i, gj = tj * T + j;
+                        v = (gi == gj && gi < C->N ? 1.0f : 0.0f) - v;
+                    }
+                    c[i * T + j] = v;
+                    if (s)
+                        s[i * T + j] += v;
+                }
+        }
+
+        // Строка тайлов X больше не нужна
+        for (size_t tk = 0; tk < nt; ++tk)
+            ooc_advise(X, ti, tk, MADV_DONTNEED);
+    }
+}
+
+// B = A^T / (||A||_1 ||A||_inf): суммы строк и столбцов — один проход
+// по тайлам A, затем транспонирование тайлов
+static int ooc_generate_B(const struct ooc_matrix *A, struct ooc_matrix *B)
+{
+    size_t nt = A->nt, T = A->T;
+    float *sums = calloc(2 * nt * T, sizeof(float));
+    float *row_sums = sums, *col_sums = sums + nt * T;
+    float max_row_sum = __FLT_MIN__, max_col_sum = __FLT_MIN__;
+
+    if (!sums) return 0;
+
+    for (size_t ti = 0; ti < nt; ++ti)
+        for (size_t tj = 0; tj < nt; ++tj) {
+            const float *a = ooc_tile(A, ti, tj);
+            ooc_advise(A, ti, tj + 1, MADV_WILLNEED);
+            for (size_t i = 0; i < T; ++i)
+                for (size_t j = 0; j < T; ++j) {
+                    row_sums[ti * T + i] += a[i * T + j];
+                    col_sums[tj * T + j] += a[i * T + j];
+                }
+        }
+
+    for (size_t i = 0; i < A->N; ++i) {
+        if (row_sums[i] > max_row_sum) max_row_sum = row_sums[i];
+        if (col_sums[i] > max_col_sum) max_col_sum = col_sums[i];
+    }
+    free(sums);
+
+    float scaling_factor = max_row_sum * max_col_sum;
+    if (scaling_factor == 0) return 0;
+
+    for (size_t ti = 0; ti < nt; ++ti)
+        for (size_t tj = 0; tj < nt; ++tj) {
+            const float *a = ooc_tile(A, tj, ti);
+            float *b = ooc_tile(B, ti, tj);
+            for (size_t i = 0; i < T; ++i)
+                for (size_t j = 0; j < T; ++j)
+                    b[i * T + j] = a[j * T + i] / scaling_factor;
+        }
+
+    return 1;
+}
+
+int ooc_create_random(const char *dir, size_t N, size_t tile)
+{
+    struct ooc_matrix A;
+    if (!ooc_map(&A, dir, "A.bin", N, tile, 1))
+        return 0;
+
+    for (size_t ti = 0; ti < A.nt; ++ti)
+        for (size_t tj = 0; tj < A.nt; ++tj) {
+            float *a = ooc_tile(&A, ti, tj);
+            size_t width = N - tj * tile < tile ? N - tj * tile : tile;
+            // Те же числа, что дал бы create_random_matrix
+            for (size_t i = 0; i < tile && ti * tile + i < N; ++i)
+                random_fill(a + i * tile, (ti * tile + i) * N + tj * tile, width);
+        }
+
+    ooc_unmap(&A);
+    return 1;
+}
+
+int ooc_load(const char *dir, const char *name, float *M, size_t N, size_t tile)
+{
+    struct ooc_matrix m;
+    if (!ooc_map(&m, dir, name, N, tile, 0))
+        return 0;
+
+    for (size_t i = 0; i < N; ++i)
+        for (size_t j = 0; j < N; ++j)
+            M[i * N + j] = ooc_tile(&m, i / tile, j / tile)[(i % tile) * tile + j % tile];
+
+    ooc_unmap(&m);
+    return 1;
+}
+
+int matrix_invert_ooc(const char *dir, size_t N, size_t M, size_t tile)
+{
+    // Временные матрицы удаляются в конце, A и X остаются
+    static const char *temp_names[] = { "B.bin", "R.bin", "P.bin", "Q.bin", "S.bin" };
+    struct ooc_matrix A = {0}, X = {0}, tmp[5] = {{0}};
+    struct ooc_matrix *B = &tmp[0], *R = &tmp[1], *power = &tmp[2],
+                      *next = &tmp[3], *sum = &tmp[4];
+    float *acc = matrix_alloc(tile * tile);
+    int ok = acc && ooc_map(&A, dir, "A.bin", N, tile, 0) &&
+             ooc_map(&X, dir, "X.bin", N, tile, 1);
+
+    for (size_t i = 0; i < 5 && ok; ++i)
+        ok = ooc_map(&tmp[i], dir, temp_names[i], N, tile, 1);
+
+    if (ok)
+        ok = ooc_generate_B(&A, B);
+
+    if (ok) {
+        ooc_multiply(B, &A, R, acc, 1, NULL);
+
+        // sum = I + R
+        memcpy(sum->data, R->data, R->bytes);
+        for (size_t i = 0; i < N; ++i)
+            ooc_tile(sum, i / tile, i / tile)[(i % tile) * (tile + 1)] += 1.0f;
+
+        const struct ooc_matrix *current_power = R;
+        struct ooc_matrix *out = power;
+        for (size_t i = 2; i <= M; ++i) {
+            ooc_multiply(current_power, R, out, acc, 0, sum);
+            current_power = out;
+            out = out == power ? next : power;
+        }
+
+        ooc_multiply(sum, B, &X, acc, 0, NULL);
+        ok = msync(X.data, X.bytes, MS_SYNC) == 0;
+    }
+
+    char path[4096];
+    for (size_t i = 0; i < 5; ++i) {
+        ooc_unmap(&tmp[i]);
+        snprintf(path, sizeof(path), "%s/%s", dir, temp_names[i]);
+        unlink(path);
+    }
+    ooc_unmap(&A);
+    ooc_unmap(&X);
+    free(acc);
+    return ok;
+}
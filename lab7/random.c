@@ -0,0 +1,126 @@
+#include <stdint.h>
+
+#include "matrix.h"
+
+// Генератор со счётчиком Philox4x32-10 (Salmon и др., Random123):
+// число с номером e зависит только от ключа и e, поэтому любой кусок
+// матрицы можно заполнить независимо, и результат не зависит от того,
+// сколько потоков и в каком порядке его заполняли.
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+
+// Заполнения меньше этого числа групп по PHILOX_LANES блоков не делятся между потоками
+#define RANDOM_PARALLEL_MIN 1024
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+#define RANDOM_CLONES __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define RANDOM_CLONES
+#endif
+
+static unsigned long long random_seed;
+
+void random_set_seed(unsigned long long seed)
+{
+    random_seed = seed;
+}
+
+// Четыре числа блока с номером block, в [0, 1)
+static inline void philox_block(uint64_t block, uint64_t seed, float out[4])
+{
+    uint32_t c0 = (uint32_t)block, c1 = (uint32_t)(block >> 32), c2 = 0, c3 = 0;
+    uint32_t k0 = (uint32_t)seed, k1 = (uint32_t)(seed >> 32);
+
+    for (int r = 0; r < 10; ++r) {
+        uint64_t p0 = (uint64_t)PHILOX_M0 * c0;
+        uint64_t p1 = (uint64_t)PHILOX_M1 * c2;
+        uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+        uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+        c1 = (uint32_t)p1;
+        c3 = (uint32_t)p0;
+        c0 = n0;
+        c2 = n2;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    // Старшие 24 бита — ровно мантисса float
+    out[0] = (c0 >> 8) * (1.0f / 16777216.0f);
+    out[1] = (c1 >> 8) * (1.0f / 16777216.0f);
+    out[2] = (c2 >> 8) * (1.0f / 16777216.0f);
+    out[3] = (c3 >> 8) * (1.0f / 16777216.0f);
+}
+
+// PHILOX_LANES блоков подряд как векторы (расширение GCC): 32-битные
+// слова лежат в 64-битных дорожках, и 32 x 32 -> 64 — одно векторное
+// умножение (vpmuludq)
+#define PHILOX_LANES 8
+
+typedef uint64_t philox_vec __attribute__((vector_size(PHILOX_LANES * sizeof(uint64_t))));
+
+// Встраивается, чтобы компилироваться под набор команд каждой версии random_fill
+static inline __attribute__((always_inline))
+void philox_lanes(uint64_t first_block, uint64_t seed, float *out)
+{
+    const philox_vec low = (philox_vec){0} + 0xffffffffu;
+    philox_vec block, c0, c1, c2, c3;
+
+    for (int l = 0; l < PHILOX_LANES; ++l)
+        block[l] = first_block + l;
+    c0 = block & low;
+    c1 = block >> 32;
+    c2 = c3 = (philox_vec){0};
+
+    uint32_t k0 = (uint32_t)seed, k1 = (uint32_t)(seed >> 32);
+    for (int r = 0; r < 10; ++r) {
+        philox_vec p0 = c0 * PHILOX_M0;
+        philox_vec p1 = c2 * PHILOX_M1;
+        philox_vec n0 = (p1 >> 32) ^ c1 ^ k0;
+        philox_vec n2 = (p0 >> 32) ^ c3 ^ k1;
+        c1 = p1 & low;
+        c3 = p0 & low;
+        c0 = n0;
+        c2 = n2;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    for (int l = 0; l < PHILOX_LANES; ++l) {
+        out[4 * l] = (uint32_t)(c0[l] >> 8) * (1.0f / 16777216.0f);
+        out[4 * l + 1] = (uint32_t)(c1[l] >> 8) * (1.0f / 16777216.0f);
+        out[4 * l + 2] = (uint32_t)(c2[l] >> 8) * (1.0f / 16777216.0f);
+        out[4 * l + 3] = (uint32_t)(c3[l] >> 8) * (1.0f / 16777216.0f);
+    }
+}
+
+RANDOM_CLONES
+void random_fill(float *out, unsigned long long first, size_t count)
+{
+    uint64_t seed = random_seed;
+    float r[4];
+
+    // Невыровненное по блоку начало и хвост — поштучно
+    size_t head = (4 - first % 4) % 4;
+    if (head > count) head = count;
+    for (size_t e = 0; e < head; ++e) {
+        philox_block((first + e) / 4, seed, r);
+        out[e] = r[(first + e) % 4];
+    }
+
+    size_t groups = (count - head) / (4 * PHILOX_LANES);
+    uint64_t first_block = (first + head) / 4;
+    float *dst = out + head;
+
+    // Статическое расписание: каждый поток первым касается своего
+    // непрерывного куска, и страницы попадают на его узел NUMA
+    #pragma omp parallel for schedule(static) if (groups >= RANDOM_PARALLEL_MIN)
+    for (size_t g = 0; g < groups; ++g)
+        philox_lanes(first_block + g * PHILOX_LANES, seed, dst + g * 4 * PHILOX_LANES);
+
+    for (size_t e = head + groups * 4 * PHILOX_LANES; e < count; ++e) {
+        philox_block((first + e) / 4, seed, r);
+        out[e] = r[(first + e) % 4];
+    }
+}
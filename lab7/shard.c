@@ -0,0 +1,319 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "matrix.h"
+#include "gemm.h"
+
+extern char **environ;
+
+// Обращение рядом, разделённое по блокам строк между процессами:
+// строки [lo, hi) всех промежуточных матриц принадлежат одному процессу,
+// закреплённому за своим узлом NUMA, и первым касается их он сам —
+// поэтому страницы лежат в памяти его узла. Степени R и сумма ряда
+// считаются построчно независимо (R^(k+1)[lo:hi] = R^k[lo:hi] * R),
+// и процессам нужно встретиться на барьере лишь дважды: после сумм
+// столбцов A и после того, как готовы B и R.
+#define SHARD_MAX_WORKERS 64
+#define SHARD_ALIGN 4096
+
+enum { SHARD_A, SHARD_B, SHARD_R, SHARD_P0, SHARD_P1, SHARD_S, SHARD_X, SHARD_ARRAYS };
+
+struct shard_header {
+    pthread_barrier_t barrier;
+    size_t N, M;
+    int workers;
+    char backend[16];
+    float row_max[SHARD_MAX_WORKERS];
+    size_t offset[SHARD_ARRAYS + 1];    // последний — частичные суммы столбцов
+    size_t bytes;
+};
+
+static size_t align_up(size_t x)
+{
+    return (x + SHARD_ALIGN - 1) & ~(size_t)(SHARD_ALIGN - 1);
+}
+
+static void shard_layout(struct shard_header *h)
+{
+    size_t at = align_up(sizeof(*h));
+    for (int i = 0; i < SHARD_ARRAYS; ++i) {
+        h->offset[i] = at;
+        at = align_up(at + h->N * h->N * sizeof(float));
+    }
+    h->offset[SHARD_ARRAYS] = at;
+    h->bytes = align_up(at + h->workers * h->N * sizeof(float));
+}
+
+static float *shard_array(struct shard_header *h, int i)
+{
+    return (float *)((char *)h + h->offset[i]);
+}
+
+int shard_node_count(void)
+{
+    char path[64];
+    int nodes = 0;
+
+    for (;; ++nodes) {
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d", nodes);
+        if (access(path, F_OK) != 0)
+            break;
+    }
+    return nodes > 0 ? nodes : 1;
+}
+
+// Закрепление за процессорами узла node (список вида "0-15,32-47").
+// Потоки OpenMP, созданные позже, наследуют маску.
+static void pin_to_node(int node)
+{
+    char path[64], list[4096];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+
+    FILE *f = fopen(path, "r");
+    if (!f) return;
+    int ok = fgets(list, sizeof(list), f) != NULL;
+    fclose(f);
+    if (!ok) return;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (char *p = list; *p && *p != '\n';) {
+        char *end;
+        long first = strtol(p, &end, 10), last = first;
+        if (end == p) break;
+        if (*end == '-')
+            last = strtol(end + 1, &end, 10);
+        for (long c = first; c <= last && c < CPU_SETSIZE; ++c)
+            CPU_SET(c, &set);
+        p = *end == ',' ? end + 1 : end;
+    }
+    if (CPU_COUNT(&set) > 0)
+        sched_setaffinity(0, sizeof(set), &set);
+}
+
+static int shard_compute(struct shard_header *h, int index)
+{
+    size_t N = h->N, M = h->M;
+    size_t lo = N * index / h->workers, hi = N * (index + 1) / h->workers, rows = hi - lo;
+    const float *A = shard_array(h, SHARD_A);
+    float *B = shard_array(h, SHARD_B), *R = shard_array(h, SHARD_R);
+    float *S = shard_array(h, SHARD_S), *X = shard_array(h, SHARD_X);
+    float *power[2] = { shard_array(h, SHARD_P0), shard_array(h, SHARD_P1) };
+    float *col_partial = shard_array(h, SHARD_ARRAYS);
+    const struct matrix_backend *be = backend_current();
+
+    // Первое касание своих строк
+    for (int i = SHARD_B; i < SHARD_ARRAYS; ++i)
+        memset(shard_array(h, i) + lo * N, 0, rows * N * sizeof(float));
+
+    float row_max = __FLT_MIN__;
+    float *cols = col_partial + index * N;
+    memset(cols, 0, N * sizeof(float));
+    for (size_t i = lo; i < hi; ++i) {
+        float row = 0;
+        for (size_t j = 0; j < N; ++j) {
+            row += A[i * N + j];
+            cols[j] += A[i * N + j];
+        }
+        if (row > row_max) row_max = row;
+    }
+    h->row_max[index] = row_max;
+    pthread_barrier_wait(&h->barrier);
+
+    // Все процессы сводят частичные суммы в одном порядке и получают
+    // один и тот же масштаб
+    float max_row_sum = __FLT_MIN__, max_col_sum = __FLT_MIN__;
+    for (int w = 0; w < h->workers; ++w)
+        if (h->row_max[w] > max_row_sum) max_row_sum = h->row_max[w];
+    for (size_t j = 0; j < N; ++j) {
+        float col = 0;
+        for (int w = 0; w < h->workers; ++w)
+            col += col_partial[w * N + j];
+        if (col > max_col_sum) max_col_sum = col;
+    }
+    float scaling_factor = max_row_sum * max_col_sum;
+    if (scaling_factor == 0)
+        return 0;
+
+    for (size_t i = lo; i < hi; ++i)
+        for (size_t j = 0; j < N; ++j)
+            B[i * N + j] = A[j * N + i] / scaling_factor;
+
+    // R[lo:hi] = I - B[lo:hi] * A: диагональ эпилога считается от начала
+    // блока, поэтому единицы добавляются отдельно
+    const struct gemm_epilogue negate = { .negate = 1 };
+    be->sgemm(rows, N, N, B + lo * N, N, A, N, R + lo * N, N, &negate);
+    for (size_t i = lo; i < hi; ++i)
+        R[i * N + i] += 1.0f;
+    memcpy(S + lo * N, R + lo * N, rows * N * sizeof(float));
+    for (size_t i = lo; i < hi; ++i)
+        S[i * N + i] += 1.0f;
+    pthread_barrier_wait(&h->barrier);
+
+    // Своя упакованная копия R лежит в памяти своего узла
+    float *packed = NULL;
+    if (be->kernel && M >= 2) {
+        packed = matrix_alloc(gemm_packed_b_size(be->kernel, N, N));
+        if (packed)
+            gemm_pack_b(be->kernel, N, N, R, N, packed);
+    }
+
+    const struct gemm_epilogue add_to_S = { .C2 = S + lo * N, .ldc2 = N };
+    const float *current = R + lo * N;
+    for (size_t k = 2; k <= M; ++k) {
+        float *out = power[k & 1] + lo * N;
+        if (packed)
+            gemm_sgemm_packed(be->kernel, rows, N, N, current, N, packed, out, N, &add_to_S);
+        else
+            be->sgemm(rows, N, N, current, N, R, N, out, N, &add_to_S);
+        current = out;
+    }
+    free(packed);
+
+    be->sgemm(rows, N, N, S + lo * N, N, B, N, X + lo * N, N, NULL);
+    return 1;
+}
+
+// Потоки GEMM рабочего процесса: процессоры его маски, поделённые между
+// рабочими того же узла; 0, если маска неизвестна
+static int worker_threads(int index, int workers, int nodes)
+{
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) != 0)
+        return 0;
+
+    int node = index % nodes;
+    int sharers = (workers - node + nodes - 1) / nodes;
+    int threads = CPU_COUNT(&set) / (sharers > 0 ? sharers : 1);
+    return threads > 0 ? threads : 1;
+}
+
+int shard_worker_main(const char *arg)
+{
+    char name[64];
+    const char *colon = strrchr(arg, ':');
+    if (!colon || (size_t)(colon - arg) >= sizeof(name))
+        return 1;
+    memcpy(name, arg, colon - arg);
+    name[colon - arg] = '\0';
+    int index = atoi(colon + 1);
+
+    int fd = shm_open(name, O_RDWR, 0);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0) close(fd);
+        return 1;
+    }
+    struct shard_header *h = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (h == MAP_FAILED)
+        return 1;
+
+    // До первой параллельной области: число потоков OpenMP берётся из маски
+    int nodes = shard_node_count();
+    pin_to_node(index % nodes);
+    int ok = backend_init(h->backend) != NULL;
+    if (ok && backend_current()->kernel) {
+        // Кэш автотюнера хранит потоки для всей машины: рабочему
+        // достаются только процессоры его узла
+        struct gemm_kernel *kern = (struct gemm_kernel *)backend_current()->kernel;
+        gemm_autotune(kern, 0);
+        int cap = worker_threads(index, h->workers, nodes);
+        if (cap > 0 && (kern->threads <= 0 || kern->threads > cap))
+            kern->threads = cap;
+    }
+    ok = ok && shard_compute(h, index);
+
+    munmap(h, st.st_size);
+    return !ok;
+}
+
+// Рабочие процессы — та же программа, запущенная заново с флагом
+// --shard-worker: после fork из процесса, уже создавшего потоки OpenMP,
+// пользоваться OpenMP нельзя
+int matrix_invert_sharded(const float *A, float *result, size_t N, size_t M, int workers)
+{
+    struct shard_header layout = { .N = N, .M = M, .workers = workers };
+    char name[64];
+    pid_t pids[SHARD_MAX_WORKERS];
+    int started = 0, ok = 1;
+
+    if (workers < 1 || workers > SHARD_MAX_WORKERS || (size_t)workers > N)
+        return 0;
+
+    shard_layout(&layout);
+    snprintf(name, sizeof(name), "/lab7-shard-%d", (int)getpid());
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0)
+        return 0;
+    if (ftruncate(fd, (off_t)layout.bytes) != 0) {
+        close(fd);
+        shm_unlink(name);
+        return 0;
+    }
+    struct shard_header *h = mmap(NULL, layout.bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (h == MAP_FAILED) {
+        shm_unlink(name);
+        return 0;
+    }
+
+    *h = layout;
+    snprintf(h->backend, sizeof(h->backend), "%s", backend_current()->name);
+    pthread_barrierattr_t attr;
+    pthread_barrierattr_init(&attr);
+    pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_barrier_init(&h->barrier, &attr, workers);
+    pthread_barrierattr_destroy(&attr);
+
+    // A читают все процессы целиком, поэтому её размещение ни одному не выгоднее
+    memcpy(shard_array(h, SHARD_A), A, N * N * sizeof(float));
+
+    for (; started < workers; ++started) {
+        char flag[96];
+        snprintf(flag, sizeof(flag), "--shard-worker=%s:%d", name, started);
+        char *argv[] = { "lab7", flag, NULL };
+        if (posix_spawn(&pids[started], "/proc/self/exe", NULL, NULL, argv, environ) != 0) {
+            ok = 0;
+            break;
+        }
+    }
+
+    // Без одного из процессов остальные не пройдут барьер
+    if (!ok)
+        for (int i = 0; i < started; ++i)
+            kill(pids[i], SIGTERM);
+
+    for (int done = 0; done < started; ++done) {
+        int status;
+        pid_t pid = wait(&status);
+        if (pid < 0)
+            break;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            if (ok)
+                for (int i = 0; i < started; ++i)
+                    if (pids[i] != pid)
+                        kill(pids[i], SIGTERM);
+            ok = 0;
+        }
+    }
+
+    if (ok)
+        memcpy(result, shard_array(h, SHARD_X), N * N * sizeof(float));
+
+    pthread_barrier_destroy(&h->barrier);
+    munmap(h, layout.bytes);
+    shm_unlink(name);
+    return ok;
+}
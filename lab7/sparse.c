@@ -0,0 +1,468 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "matrix.h"
+
+// Разреженные матрицы в формате CSR: строка i занимает позиции
+// [row_ptr[i], row_ptr[i + 1]) массивов col и val. Столбцы внутри
+// строки не обязательно упорядочены — все операции собирают строку
+// в плотный аккумулятор (схема Густавсона).
+
+struct csr_matrix *csr_create(size_t n, size_t cap)
+{
+    struct csr_matrix *m = calloc(1, sizeof(*m));
+    if (!m) return NULL;
+
+    m->n = n;
+    m->row_ptr = calloc(n + 1, sizeof(size_t));
+    m->col = malloc((cap ? cap : 1) * sizeof(unsigned int));
+    m->val = malloc((cap ? cap : 1) * sizeof(float));
+    m->cap = cap ? cap : 1;
+
+    if (!m->row_ptr || !m->col || !m->val) {
+        csr_destroy(m);
+        return NULL;
+    }
+    return m;
+}
+
+void csr_destroy(struct csr_matrix *m)
+{
+    if (!m) return;
+
+    free(m->row_ptr); free(m->col); free(m->val);
+    free(m);
+}
+
+size_t csr_bytes(const struct csr_matrix *m)
+{
+    return (m->n + 1) * sizeof(size_t) + m->cap * (sizeof(unsigned int) + sizeof(float));
+}
+
+// Место под nnz элементов; старое содержимое не сохраняется
+static int csr_reserve(struct csr_matrix *m, size_t nnz)
+{
+    if (nnz <= m->cap)
+        return 1;
+
+    free(m->col); free(m->val);
+    m->col = malloc(nnz * sizeof(unsigned int));
+    m->val = malloc(nnz * sizeof(float));
+    m->cap = m->col && m->val ? nnz : 0;
+    return m->cap != 0;
+}
+
+static void csr_swap(struct csr_matrix **a, struct csr_matrix **b)
+{
+    struct csr_matrix *t = *a;
+    *a = *b;
+    *b = t;
+}
+
+void csr_to_dense(const struct csr_matrix *m, float *dense)
+{
+    size_t n = m->n;
+
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < n; ++i) {
+        memset(dense + i * n, 0, n * sizeof(float));
+        for (size_t p = m->row_ptr[i]; p < m->row_ptr[i + 1]; ++p)
+            dense[i * n + m->col[p]] += m->val[p];
+    }
+}
+
+static struct csr_matrix *csr_identity(size_t n)
+{
+    struct csr_matrix *m = csr_create(n, n);
+    if (!m) return NULL;
+
+    for (size_t i = 0; i < n; ++i) {
+        m->row_ptr[i + 1] = i + 1;
+        m->col[i] = (unsigned int)i;
+        m->val[i] = 1.0f;
+    }
+    m->nnz = n;
+    return m;
+}
+
+static int compare_columns(const void *a, const void *b)
+{
+    unsigned int x = *(const unsigned int *)a, y = *(const unsigned int *)b;
+    return (x > y) - (x < y);
+}
+
+// Элемент (i, j) берётся из random_fill по номеру i * n + j, как и в
+// плотной create_random_matrix. Диагональ увеличена на 1, чтобы матрица
+// была заведомо обратима.
+static void fill_row_values(struct csr_matrix *m, size_t i)
+{
+    for (size_t p = m->row_ptr[i]; p < m->row_ptr[i + 1]; ++p) {
+        random_fill(&m->val[p], (unsigned long long)i * m->n + m->col[p], 1);
+        if (m->col[p] == i)
+            m->val[p] += 1.0f;
+    }
+}
+
+struct csr_matrix *csr_banded(size_t N, size_t bandwidth)
+{
+    struct csr_matrix *m = csr_create(N, N * (2 * bandwidth + 1));
+    if (!m) return NULL;
+
+    size_t p = 0;
+    for (size_t i = 0; i < N; ++i) {
+        size_t j0 = i > bandwidth ? i - bandwidth : 0;
+        size_t j1 = i + bandwidth < N ? i + bandwidth + 1 : N;
+        for (size_t j = j0; j < j1; ++j)
+            m->col[p++] = (unsigned int)j;
+        m->row_ptr[i + 1] = p;
+    }
+    m->nnz = p;
+
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < N; ++i)
+        fill_row_values(m, i);
+    return m;
+}
+
+struct csr_matrix *csr_random(size_t N, float density)
+{
+    // Около density * N случайных столбцов в строке плюс диагональ
+    size_t per_row = (size_t)(density * N) + 1;
+    if (per_row > N) per_row = N;
+
+    struct csr_matrix *m = csr_create(N, N * per_row);
+    float *u = malloc(per_row * sizeof(float));
+    if (!m || !u) {
+        csr_destroy(m); free(u);
+        return NULL;
+    }
+
+    size_t p = 0;
+    for (size_t i = 0; i < N; ++i) {
+        unsigned int *cols = m->col + p;
+        // Позиции — из отдельного потока чисел после значений
+        random_fill(u, (unsigned long long)N * N + (unsigned long long)i * per_row, per_row);
+        cols[0] = (unsigned int)i;
+        for (size_t k = 1; k < per_row; ++k) {
+            size_t j = (size_t)(u[k] * N);
+            cols[k] = (unsigned int)(j < N ? j : N - 1);
+        }
+
+        qsort(cols, per_row, sizeof(unsigned int), compare_columns);
+        size_t count = 0;
+        for (size_t k = 0; k < per_row; ++k)
+            if (count == 0 || cols[count - 1] != cols[k])
+                cols[count++] = cols[k];
+
+        p += count;
+        m->row_ptr[i + 1] = p;
+    }
+    m->nnz = p;
+    free(u);
+
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < N; ++i)
+        fill_row_values(m, i);
+    return m;
+}
+
+// B = A^T / (||A||_1 ||A||_inf), как generate_B для плотной матрицы
+static struct csr_matrix *csr_generate_B(const struct csr_matrix *A)
+{
+    size_t n = A->n;
+    float *sums = calloc(2 * n, sizeof(float));
+    struct csr_matrix *B = csr_create(n, A->nnz);
+    float max_row_sum = __FLT_MIN__, max_col_sum = __FLT_MIN__;
+
+    if (!sums || !B) {
+        free(sums); csr_destroy(B);
+        return NULL;
+    }
+
+    float *row_sums = sums, *col_sums = sums + n;
+    for (size_t i = 0; i < n; ++i)
+        for (size_t p = A->row_ptr[i]; p < A->row_ptr[i + 1]; ++p) {
+            row_sums[i] += A->val[p];
+            col_sums[A->col[p]] += A->val[p];
+            B->row_ptr[A->col[p] + 1]++;
+        }
+
+    for (size_t i = 0; i < n; ++i) {
+        if (row_sums[i] > max_row_sum) max_row_sum = row_sums[i];
+        if (col_sums[i] > max_col_sum) max_col_sum = col_sums[i];
+        B->row_ptr[i + 1] += B->row_ptr[i];
+    }
+    free(sums);
+
+    float scaling_factor = max_row_sum * max_col_sum;
+    if (scaling_factor == 0) {
+        csr_destroy(B);
+        return NULL;
+    }
+
+    // Разброс по строкам B: столбцы в каждой строке выходят упорядоченными
+    size_t *next = malloc(n * sizeof(size_t));
+    if (!next) {
+        csr_destroy(B);
+        return NULL;
+    }
+    memcpy(next, B->row_ptr, n * sizeof(size_t));
+    for (size_t i = 0; i < n; ++i)
+        for (size_t p = A->row_ptr[i]; p < A->row_ptr[i + 1]; ++p) {
+            size_t q = next[A->col[p]]++;
+            B->col[q] = (unsigned int)i;
+            B->val[q] = A->val[p] / scaling_factor;
+        }
+    B->nnz = A->nnz;
+    free(next);
+    return B;
+}
+
+// Общая часть умножения и сложения: строка i результата — сумма строк
+// с весами. Для умножения это строки Y[k] с весами X[i][k]; для
+// сложения — строки X[i] и Y[i] с весами 1 и alpha.
+struct csr_row_source {
+    const struct csr_matrix *X, *Y;
+    float alpha;        // вес второго слагаемого при сложении
+    int add;
+};
+
+// body выполняется для каждого слагаемого строки i: столбец j, значение v
+#define CSR_FOR_ROW(src, i, j, v, body) do { \
+        if ((src)->add) { \
+            for (size_t p_ = (src)->X->row_ptr[i]; p_ < (src)->X->row_ptr[(i) + 1]; ++p_) { \
+                size_t j = (src)->X->col[p_]; float v = (src)->X->val[p_]; body \
+            } \
+            for (size_t p_ = (src)->Y->row_ptr[i]; p_ < (src)->Y->row_ptr[(i) + 1]; ++p_) { \
+                size_t j = (src)->Y->col[p_]; float v = (src)->alpha * (src)->Y->val[p_]; body \
+            } \
+        } else { \
+            for (size_t p_ = (src)->X->row_ptr[i]; p_ < (src)->X->row_ptr[(i) + 1]; ++p_) { \
+                size_t k_ = (src)->X->col[p_]; float x_ = (src)->X->val[p_]; \
+                for (size_t q_ = (src)->Y->row_ptr[k_]; q_ < (src)->Y->row_ptr[k_ + 1]; ++q_) { \
+                    size_t j = (src)->Y->col[q_]; float v = x_ * (src)->Y->val[q_]; body \
+                } \
+            } \
+        } \
+    } while (0)
+
+// Два прохода: сначала число различных столбцов в каждой строке, затем
+// значения. Каждому потоку — свои метки и плотный аккумулятор строки.
+static int csr_combine(const struct csr_row_source *src, struct csr_matrix *C)
+{
+    size_t n = src->X->n;
+    int failed = 0;
+
+    C->n = n;
+    C->row_ptr[0] = 0;
+
+    #pragma omp parallel
+    {
+        size_t *mark = malloc(n * sizeof(size_t));
+        float *acc = malloc(n * sizeof(float));
+
+        if (!mark || !acc) {
+            #pragma omp atomic write
+            failed = 1;
+        } else {
+            memset(mark, 0xff, n * sizeof(size_t));
+        }
+
+        #pragma omp for schedule(dynamic, 64)
+        for (size_t i = 0; i < n; ++i) {
+            size_t count = 0;
+            if (mark) {
+                CSR_FOR_ROW(src, i, j, v, {
+                    (void)v;
+                    if (mark[j] != i) { mark[j] = i; ++count; }
+                });
+            }
+            C->row_ptr[i + 1] = count;
+        }
+
+        #pragma omp single
+        {
+            for (size_t i = 0; i < n; ++i)
+                C->row_ptr[i + 1] += C->row_ptr[i];
+            C->nnz = C->row_ptr[n];
+            if (!failed && !csr_reserve(C, C->nnz))
+                failed = 1;
+        }
+
+        if (mark)
+            memset(mark, 0xff, n * sizeof(size_t));
+
+        #pragma omp for schedule(dynamic, 64)
+        for (size_t i = 0; i < n; ++i) {
+            if (failed || !mark || !acc)
+                continue;
+            size_t pos = C->row_ptr[i];
+            CSR_FOR_ROW(src, i, j, v, {
+                if (mark[j] != i) { mark[j] = i; acc[j] = 0; C->col[pos++] = (unsigned int)j; }
+                acc[j] += v;
+            });
+            for (size_t p = C->row_ptr[i]; p < pos; ++p)
+                C->val[p] = acc[C->col[p]];
+        }
+
+        free(mark);
+        free(acc);
+    }
+
+    return !failed;
+}
+
+int sparse_multiply(const struct csr_matrix *X, const struct csr_matrix *Y,
+                    struct csr_matrix *C)
+{
+    struct csr_row_source src = { X, Y, 0, 0 };
+    return csr_combine(&src, C);
+}
+
+int sparse_add(const struct csr_matrix *X, const struct csr_matrix *Y, float alpha,
+               struct csr_matrix *C)
+{
+    struct csr_row_source src = { X, Y, alpha, 1 };
+    return csr_combine(&src, C);
+}
+
+void sparse_multiply_dense(const struct csr_matrix *X, const struct csr_matrix *Y,
+                           float *C)
+{
+    size_t n = X->n;
+
+    // Строка C сама служит аккумулятором
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (size_t i = 0; i < n; ++i) {
+        float *c = C + i * n;
+        memset(c, 0, n * sizeof(float));
+        for (size_t p = X->row_ptr[i]; p < X->row_ptr[i + 1]; ++p) {
+            size_t k = X->col[p];
+            float x = X->val[p];
+            for (size_t q = Y->row_ptr[k]; q < Y->row_ptr[k + 1]; ++q)
+                c[Y->col[q]] += x * Y->val[q];
+        }
+    }
+}
+
+void dense_multiply_sparse(const float *X, const struct csr_matrix *Y, float *C,
+                           float *sum)
+{
+    size_t n = Y->n;
+
+    // C[i] = сумма X[i][k] * Y[k]: O(N * nnz(Y)) вместо O(N^3)
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < n; ++i) {
+        const float *x = X + i * n;
+        float *c = C + i * n;
+        memset(c, 0, n * sizeof(float));
+        for (size_t k = 0; k < n; ++k) {
+            if (x[k] == 0)
+                continue;
+            for (size_t q = Y->row_ptr[k]; q < Y->row_ptr[k + 1]; ++q)
+                c[Y->col[q]] += x[k] * Y->val[q];
+        }
+        if (sum)
+            for (size_t j = 0; j < n; ++j)
+                sum[i * n + j] += c[j];
+    }
+}
+
+int matrix_invert_sparse(const struct csr_matrix *A, float *result, size_t M,
+                         float max_density, struct sparse_stats *stats)
+{
+    size_t n = A->n;
+    double dense_nnz = (double)n * n;
+    struct csr_matrix *B = csr_generate_B(A);
+    struct csr_matrix *I = csr_identity(n);
+    struct csr_matrix *R = csr_create(n, A->nnz);
+    struct csr_matrix *S = csr_create(n, A->nnz);
+    struct csr_matrix *power = csr_create(n, A->nnz);
+    struct csr_matrix *next = csr_create(n, A->nnz);
+    float *dense_power = NULL, *dense_next = NULL, *dense_sum = NULL, *dense_R = NULL;
+    int ok = B && I && R && S && power && next;
+    size_t i = 2;
+
+    struct sparse_stats st = { 0, 0 };
+#define TRACK_PEAK(extra) do { \
+        size_t bytes_ = csr_bytes(A) + csr_bytes(B) + csr_bytes(I) + csr_bytes(R) + \
+                        csr_bytes(S) + csr_bytes(power) + csr_bytes(next) + (extra); \
+        if (bytes_ > st.peak_bytes) st.peak_bytes = bytes_; \
+    } while (0)
+
+    // R = I - BA, S = I + R; BA считается в next
+    ok = ok && sparse_multiply(B, A, next) && sparse_add(I, next, -1.0f, R) &&
+         sparse_add(I, R, 1.0f, S);
+    if (ok) {
+        st.sparse_terms = 1;
+        TRACK_PEAK(0);
+    }
+
+    // Пока степени R остаются разреженными, ряд идёт целиком в CSR
+    const struct csr_matrix *current_power = R;
+    int sparse_R = ok && R->nnz <= max_density * dense_nnz;
+    int have_next = 0;
+    for (; ok && sparse_R && i <= M; ++i) {
+        ok = sparse_multiply(current_power, R, next);
+        if (ok && next->nnz > max_density * dense_nnz) {
+            have_next = 1;
+            break;
+        }
+
+        ok = ok && sparse_add(S, next, 1.0f, power);
+        csr_swap(&S, &power);
+        csr_swap(&power, &next);
+        current_power = power;
+        st.sparse_terms = i;
+        TRACK_PEAK(0);
+    }
+
+    if (ok && i <= M) {
+        // Заполнение превысило порог: степень и сумма становятся плотными.
+        // Если сама R разреженная, шаг стоит O(N * nnz(R)), иначе это
+        // обычное плотное умножение.
+        dense_power = matrix_alloc(n * n);
+        dense_next = matrix_alloc(n * n);
+        dense_sum = matrix_alloc(n * n);
+        dense_R = sparse_R ? NULL : matrix_alloc(n * n);
+        ok = dense_power && dense_next && dense_sum && (sparse_R || dense_R);
+    }
+
+    if (ok && i <= M) {
+        csr_to_dense(S, dense_sum);
+        if (have_next) {
+            csr_to_dense(next, dense_power);
+            for (size_t e = 0; e < n * n; ++e)
+                dense_sum[e] += dense_power[e];
+            ++i;
+        } else {
+            csr_to_dense(current_power, dense_power);
+        }
+        if (!sparse_R)
+            csr_to_dense(R, dense_R);
+        TRACK_PEAK((sparse_R ? 3 : 4) * n * n * sizeof(float));
+
+        struct gemm_epilogue add_to_sum = { .C2 = dense_sum, .ldc2 = n };
+        for (; i <= M; ++i) {
+            if (sparse_R)
+                dense_multiply_sparse(dense_power, R, dense_next, dense_sum);
+            else
+                matrix_multiply_ex(dense_power, dense_R, dense_next, n, &add_to_sum);
+            float *t = dense_power;
+            dense_power = dense_next;
+            dense_next = t;
+        }
+        dense_multiply_sparse(dense_sum, B, result, NULL);
+    } else if (ok) {
+        sparse_multiply_dense(S, B, result);
+    }
+#undef TRACK_PEAK
+
+    if (stats)
+        *stats = st;
+
+    csr_destroy(B); csr_destroy(I); csr_destroy(R); csr_destroy(S);
+    csr_destroy(power); csr_destroy(next);
+    free(dense_power); free(dense_next); free(dense_sum); free(dense_R);
+    return ok;
+}
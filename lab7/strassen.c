@@ -0,0 +1,113 @@
+#include <stddef.h>
+
+#include "matrix.h"
+
+// Поэлементные проходы меньше этого размера не делятся между потоками
+#define STRASSEN_PARALLEL_MIN 256
+
+// Z = X + sign * Y для блоков n x n
+static void block_add(size_t n, const float *X, size_t ldx,
+                      const float *Y, size_t ldy, float *Z, size_t ldz, float sign)
+{
+    #pragma omp parallel for if (n >= STRASSEN_PARALLEL_MIN)
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = 0; j < n; ++j)
+            Z[i * ldz + j] = X[i * ldx + j] + sign * Y[i * ldy + j];
+}
+
+// Для нечётного n рекурсия идёт по ведущему блоку m = n - 1, а последние
+// строка и столбец досчитываются здесь за O(n^2)
+static void peel_fixup(size_t n, const float *A, size_t lda,
+                       const float *B, size_t ldb, float *C, size_t ldc)
+{
+    size_t m = n - 1;
+
+    // C11 += a12 * b21 (внешнее произведение)
+    #pragma omp parallel for if (n >= STRASSEN_PARALLEL_MIN)
+    for (size_t i = 0; i < m; ++i) {
+        float a = A[i * lda + m];
+        for (size_t j = 0; j < m; ++j)
+            C[i * ldc + j] += a * B[m * ldb + j];
+    }
+
+    // Последний столбец целиком
+    for (size_t i = 0; i < n; ++i) {
+        float s = 0.0f;
+        for (size_t k = 0; k < n; ++k)
+            s += A[i * lda + k] * B[k * ldb + m];
+        C[i * ldc + m] = s;
+    }
+
+    // Последняя строка без угла
+    for (size_t j = 0; j < m; ++j)
+        C[m * ldc + j] = 0.0f;
+    for (size_t k = 0; k < n; ++k) {
+        float a = A[m * lda + k];
+        for (size_t j = 0; j < m; ++j)
+            C[m * ldc + j] += a * B[k * ldb + j];
+    }
+}
+
+size_t strassen_work_size(size_t N, size_t crossover)
+{
+    size_t size = 0;
+
+    // Два временных блока половинного размера на каждый уровень рекурсии
+    while (crossover && N >= crossover && N >= 2) {
+        size_t h = N / 2;
+        size += 2 * h * h;
+        N = h;
+    }
+    return size;
+}
+
+void strassen_multiply(const struct matrix_backend *be, size_t crossover, size_t n,
+                       const float *A, size_t lda, const float *B, size_t ldb,
+                       float *C, size_t ldc, float *work)
+{
+    if (!crossover || n < crossover || n < 2) {
+        be->sgemm(n, n, n, A, lda, B, ldb, C, ldc, NULL);
+        return;
+    }
+
+    size_t h = n / 2;
+    const float *A11 = A, *A12 = A + h, *A21 = A + h * lda, *A22 = A21 + h;
+    const float *B11 = B, *B12 = B + h, *B21 = B + h * ldb, *B22 = B21 + h;
+    float *C11 = C, *C12 = C + h, *C21 = C + h * ldc, *C22 = C21 + h;
+    float *X = work, *Y = work + h * h;
+    float *next = Y + h * h;
+
+#define MUL(P, ldp, Q, ldq, R, ldr) \
+    strassen_multiply(be, crossover, h, P, ldp, Q, ldq, R, ldr, next)
+
+    // Вариант Винограда: 7 умножений и 15 сложений. Порядок шагов позволяет
+    // держать промежуточные суммы в четвертях C и лишь двух блоках X и Y
+    // (схема Дугласа и др., GEMMW)
+    block_add(h, A11, lda, A21, lda, X, h, -1.0f);       // S3 = A11 - A21
+    block_add(h, B22, ldb, B12, ldb, Y, h, -1.0f);       // T3 = B22 - B12
+    MUL(X, h, Y, h, C21, ldc);                           // P7 = S3 * T3
+    block_add(h, A21, lda, A22, lda, X, h, 1.0f);        // S1 = A21 + A22
+    block_add(h, B12, ldb, B11, ldb, Y, h, -1.0f);       // T1 = B12 - B11
+    MUL(X, h, Y, h, C22, ldc);                           // P5 = S1 * T1
+    block_add(h, X, h, A11, lda, X, h, -1.0f);           // S2 = S1 - A11
+    block_add(h, B22, ldb, Y, h, Y, h, -1.0f);           // T2 = B22 - T1
+    MUL(X, h, Y, h, C12, ldc);                           // P6 = S2 * T2
+    block_add(h, A12, lda, X, h, X, h, -1.0f);           // S4 = A12 - S2
+    MUL(X, h, B22, ldb, C11, ldc);                       // P3 = S4 * B22
+    MUL(A11, lda, B11, ldb, X, h);                       // P1 = A11 * B11
+    block_add(h, X, h, C12, ldc, C12, ldc, 1.0f);        // U2 = P1 + P6
+    block_add(h, C12, ldc, C21, ldc, C21, ldc, 1.0f);    // U3 = U2 + P7
+    block_add(h, C12, ldc, C22, ldc, C12, ldc, 1.0f);    // U4 = U2 + P5
+    block_add(h, C21, ldc, C22, ldc, C22, ldc, 1.0f);    // U7 = U3 + P5 = C22
+    block_add(h, C12, ldc, C11, ldc, C12, ldc, 1.0f);    // U5 = U4 + P3 = C12
+    block_add(h, Y, h, B21, ldb, Y, h, -1.0f);           // T4 = T2 - B21
+    MUL(A22, lda, Y, h, C11, ldc);                       // P4 = A22 * T4
+    block_add(h, C21, ldc, C11, ldc, C21, ldc, -1.0f);   // U6 = U3 - P4 = C21
+    MUL(A12, lda, B21, ldb, C11, ldc);                   // P2 = A12 * B21
+    block_add(h, X, h, C11, ldc, C11, ldc, 1.0f);        // U1 = P1 + P2 = C11
+
+#undef MUL
+
+    if (n & 1)
+        peel_fixup(n, A, lda, B, ldb, C, ldc);
+}
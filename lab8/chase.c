@@ -0,0 +1,374 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "chase.h"
+#include "../common/perf.h"
+
+// Рост задержки больше чем в CHASE_KNEE_RATIO раз на двух точках подряд —
+// колено; переходный участок кончается, когда соседние точки отличаются
+// меньше чем в CHASE_FLAT_RATIO раз
+#define CHASE_KNEE_RATIO 1.25
+#define CHASE_FLAT_RATIO 1.10
+// Соседние плато, различающиеся меньше чем в CHASE_MERGE_RATIO раз, —
+// один уровень кэша: ступенька внутри него — промахи TLB, а не новый кэш
+#define CHASE_MERGE_RATIO 1.5
+// Если замер не дошёл до размера последнего кэша по sysfs, память узнаётся
+// по задержке: плато в CHASE_DRAM_RATIO раз медленнее предыдущего и
+// дольше CHASE_DRAM_NS — уже не кэш
+#define CHASE_DRAM_RATIO 3.0
+#define CHASE_DRAM_NS 60.0
+#define CHASE_MAX_POINTS 512
+
+
+const char *const chase_pattern_names[CHASE_PATTERNS] = { "Linear", "Reverse", "Random" };
+const char *const chase_pages_names[CHASE_PAGE_MODES] = { "system", "4k", "thp", "hugetlb" };
+
+// Последний узел обхода пишется сюда, чтобы компилятор не выбросил цикл
+void *volatile chase_sink;
+
+// Все буферы — целое число огромных страниц, выровненное на них же:
+// иначе THP не сможет отобразить края
+static size_t huge_round(size_t bytes)
+{
+    return (bytes + CHASE_HUGE_PAGE - 1) / CHASE_HUGE_PAGE * CHASE_HUGE_PAGE;
+}
+
+void *chase_alloc(size_t max_bytes, enum chase_pages pages)
+{
+    size_t len = huge_round(max_bytes);
+
+    if (pages == CHASE_PAGES_HUGETLB) {
+        void *p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        return p == MAP_FAILED ? NULL : p;
+    }
+
+    // С запасом на выравнивание; лишнее по краям возвращается системе
+    char *raw = mmap(NULL, len + CHASE_HUGE_PAGE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED)
+        return NULL;
+    char *p = (char *)(((uintptr_t)raw + CHASE_HUGE_PAGE - 1) & ~(uintptr_t)(CHASE_HUGE_PAGE - 1));
+    if (p > raw)
+        munmap(raw, p - raw);
+    if (p + len < raw + len + CHASE_HUGE_PAGE)
+        munmap(p + len, raw + len + CHASE_HUGE_PAGE - (p + len));
+
+    if (pages == CHASE_PAGES_4K)
+        madvise(p, len, MADV_NOHUGEPAGE);
+    else if (pages == CHASE_PAGES_THP)
+        madvise(p, len, MADV_HUGEPAGE);
+    return p;
+}
+
+void chase_free(void *buffer, size_t max_bytes)
+{
+    if (buffer)
+        munmap(buffer, huge_round(max_bytes));
+}
+
+int chase_parse_pages(const char *s, enum chase_pages *pages)
+{
+    for (int i = 0; i < CHASE_PAGE_MODES; ++i)
+        if (strcmp(s, chase_pages_names[i]) == 0) {
+            *pages = (enum chase_pages)i;
+            return 1;
+        }
+    return 0;
+}
+
+size_t chase_huge_bytes(void)
+{
+    char line[256];
+    size_t kb = 0, total = 0;
+    FILE *f = fopen("/proc/self/smaps_rollup", "r");
+
+    while (f && fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "AnonHugePages: %zu kB", &kb) == 1 ||
+            sscanf(line, "Private_Hugetlb: %zu kB", &kb) == 1)
+            total += kb << 10;
+    }
+    if (f) fclose(f);
+    return total;
+}
+
+static uint64_t xorshift(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static void link_node(char *base, size_t stride, size_t from, size_t to)
+{
+    *(char **)(base + from * stride) = base + to * stride;
+}
+
+// Саттоло: j < i, поэтому перестановка — один цикл длины nodes
+static uint32_t *sattolo(size_t nodes, uint64_t seed)
+{
+    uint32_t *next = malloc(nodes * sizeof(uint32_t));
+    uint64_t state = seed ? seed : 1;
+
+    if (!next)
+        return NULL;
+    for (size_t i = 0; i < nodes; ++i)
+        next[i] = (uint32_t)i;
+    for (size_t i = nodes - 1; i > 0; --i) {
+        size_t j = xorshift(&state) % i;
+        uint32_t t = next[i];
+        next[i] = next[j];
+        next[j] = t;
+    }
+    return next;
+}
+
+void chase_build(char *base, size_t nodes, size_t stride, enum chase_pattern pattern,
+                 uint64_t seed)
+{
+    if (pattern == CHASE_SEQUENTIAL) {
+        for (size_t i = 0; i < nodes; ++i)
+            link_node(base, stride, i, (i + 1) % nodes);
+        return;
+    }
+    if (pattern == CHASE_REVERSE) {
+        for (size_t i = 0; i < nodes; ++i)
+            link_node(base, stride, i, (i + nodes - 1) % nodes);
+        return;
+    }
+
+    uint32_t *next = sattolo(nodes, seed);
+    if (!next) {
+        chase_build(base, nodes, stride, CHASE_SEQUENTIAL, seed);
+        return;
+    }
+    for (size_t i = 0; i < nodes; ++i)
+        link_node(base, stride, i, next[i]);
+    free(next);
+}
+
+// Строка узла в странице i — хеш от i: иначе на огромных (физически
+// непрерывных) страницах узлы собираются в немногих наборах L2 и кэш
+// промахивается сам, без всякого TLB
+static char *page_node(char *base, size_t page, size_t i)
+{
+    size_t line = (size_t)((i * 0x9E3779B97F4A7C15ULL) >> 32) % (page / 64);
+    return base + i * page + line * 64;
+}
+
+void chase_build_pages(char *base, size_t pages, size_t page, uint64_t seed)
+{
+    uint32_t *next = sattolo(pages, seed);
+
+    for (size_t i = 0; i < pages; ++i)
+        *(char **)page_node(base, page, i) = page_node(base, page, next ? next[i] : (i + 1) % pages);
+    free(next);
+}
+
+double chase_run(const char *base, size_t hops, double *cycles)
+{
+    const char *p = base;
+    struct timespec t0, t1;
+
+    hops = (hops + 7) / 8 * 8;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    uint64_t c0 = perf_tsc_begin();
+    for (size_t h = 0; h < hops; h += 8) {
+        p = *(const char **)p; p = *(const char **)p;
+        p = *(const char **)p; p = *(const char **)p;
+        p = *(const char **)p; p = *(const char **)p;
+        p = *(const char **)p; p = *(const char **)p;
+    }
+    uint64_t c1 = perf_tsc_end();
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    chase_sink = (void *)p;
+
+    if (cycles)
+        *cycles = (double)(c1 - c0) / hops;
+    return ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / hops;
+}
+
+void chase_chain_heads(const char *base, size_t nodes, int chains, const char **heads)
+{
+    const char *p = base;
+    size_t gap = nodes / chains;
+
+    for (int c = 0; c < chains; ++c) {
+        heads[c] = p;
+        for (size_t h = 0; h < gap; ++h)
+            p = *(const char **)p;
+    }
+}
+
+double chase_run_chains(const char *const *heads, int chains, size_t hops, double *cycles)
+{
+    const char *p[CHASE_MAX_CHAINS];
+    struct timespec t0, t1;
+
+    if (chains > CHASE_MAX_CHAINS)
+        chains = CHASE_MAX_CHAINS;
+    for (int c = 0; c < chains; ++c)
+        p[c] = heads[c];
+
+    hops = (hops + 3) / 4 * 4;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    uint64_t c0 = perf_tsc_begin();
+    // Чтения разных цепочек независимы: процессор держит их промахи
+    // в полёте одновременно, сколько позволяют буферы промахов
+    for (size_t h = 0; h < hops; h += 4) {
+        for (int c = 0; c < chains; ++c) p[c] = *(const char **)p[c];
+        for (int c = 0; c < chains; ++c) p[c] = *(const char **)p[c];
+        for (int c = 0; c < chains; ++c) p[c] = *(const char **)p[c];
+        for (int c = 0; c < chains; ++c) p[c] = *(const char **)p[c];
+    }
+    uint64_t c1 = perf_tsc_end();
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    for (int c = 0; c < chains; ++c)
+        chase_sink = (void *)p[c];
+
+    double total = (double)hops * chains;
+    if (cycles)
+        *cycles = (double)(c1 - c0) / total;
+    return ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / total;
+}
+
+size_t chase_sizes(size_t min_bytes, size_t max_bytes, size_t stride, int steps_per_octave,
+                   size_t *sizes, size_t max_count)
+{
+    size_t count = 0;
+    double factor = pow(2.0, 1.0 / steps_per_octave);
+
+    for (double s = (double)min_bytes; s <= (double)max_bytes && count < max_count; s *= factor) {
+        size_t bytes = ((size_t)s + stride - 1) / stride * stride;
+        if (bytes < 2 * stride)
+            bytes = 2 * stride;
+        if (count == 0 || bytes != sizes[count - 1])
+            sizes[count++] = bytes;
+    }
+    return count;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double median(const struct chase_point *points, size_t from, size_t to,
+                     enum chase_pattern pattern, int use_cycles)
+{
+    double v[CHASE_MAX_POINTS];
+    size_t n = 0;
+    for (size_t i = from; i <= to && n < CHASE_MAX_POINTS; ++i)
+        v[n++] = use_cycles ? points[i].cycles[pattern] : points[i].ns[pattern];
+    qsort(v, n, sizeof(double), compare_double);
+    return n % 2 ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+}
+
+static size_t parse_size(const char *s)
+{
+    char *end;
+    size_t v = strtoull(s, &end, 10);
+    if (*end == 'K') v <<= 10;
+    else if (*end == 'M') v <<= 20;
+    else if (*end == 'G') v <<= 30;
+    return v;
+}
+
+size_t chase_sysfs_cache(int level)
+{
+    size_t bytes = 0;
+    char path[128], type[32], size[32];
+
+    for (int i = 0; i < 16; ++i) {
+        int l = 0;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/level", i);
+        FILE *f = fopen(path, "r");
+        if (!f) break;
+        int ok = fscanf(f, "%d", &l) == 1;
+        fclose(f);
+        if (!ok || (level && l != level))
+            continue;
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/type", i);
+        f = fopen(path, "r");
+        if (!f) continue;
+        ok = fscanf(f, "%31s", type) == 1;
+        fclose(f);
+        if (!ok || strcmp(type, "Instruction") == 0)
+            continue;
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/size", i);
+        f = fopen(path, "r");
+        if (!f) continue;
+        if (fscanf(f, "%31s", size) == 1 && parse_size(size) > bytes)
+            bytes = parse_size(size);
+        fclose(f);
+    }
+    return bytes;
+}
+
+size_t chase_detect_levels(const struct chase_point *points, size_t count,
+                           enum chase_pattern pattern, struct chase_level *levels,
+                           size_t max_levels)
+{
+    size_t n = 0, i = 0;
+
+#define V(k) (points[k].ns[pattern])
+    while (i < count && n < max_levels) {
+        size_t start = i, end = i;
+        double level = V(i);
+
+        // Плато тянется, пока нет устойчивого роста: одиночный выброс
+        // (прерывание, смена частоты) колена не образует
+        while (end + 1 < count) {
+            int rise = V(end + 1) > level * CHASE_KNEE_RATIO &&
+                       (end + 2 >= count || V(end + 2) > level * CHASE_KNEE_RATIO);
+            if (rise)
+                break;
+            ++end;
+            level = median(points, start, end, pattern, 0);
+        }
+
+        // Задержка уровня — по первому плато, без штрафа TLB
+        if (n > 0 && level < levels[n - 1].ns * CHASE_MERGE_RATIO) {
+            levels[n - 1].bytes = points[end].bytes;
+        } else {
+            struct chase_level *l = &levels[n++];
+            l->bytes = points[end].bytes;
+            l->ns = level;
+            l->cycles = median(points, start, end, pattern, 1);
+        }
+
+        if (end + 1 >= count)
+            break;
+        // Переходный участок между уровнями в плато не входит
+        i = end + 1;
+        while (i + 1 < count && V(i + 1) > V(i) * CHASE_FLAT_RATIO)
+            ++i;
+    }
+#undef V
+
+    for (size_t k = 0; k < n; ++k)
+        snprintf(levels[k].name, sizeof(levels[k].name), "L%zu", k + 1);
+
+    // Последнее плато за пределами всех кэшей — память; его размер не определён
+    size_t largest = chase_sysfs_cache(0);
+    if (n >= 2) {
+        struct chase_level *last = &levels[n - 1];
+        size_t prev_end = levels[n - 2].bytes;
+        if (!largest || prev_end >= largest / 2 ||
+            (last->ns >= levels[n - 2].ns * CHASE_DRAM_RATIO && last->ns > CHASE_DRAM_NS)) {
+            snprintf(last->name, sizeof(last->name), "DRAM");
+            last->bytes = 0;
+        }
+    }
+    return n;
+}
@@ -0,0 +1,101 @@
+#ifndef LAB8_CHASE_H
+#define LAB8_CHASE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Обход цепочки указателей: узел занимает stride байт (по умолчанию —
+// строка кэша), в первом слове лежит адрес следующего. Каждое чтение
+// зависит от предыдущего, поэтому время одного перехода — задержка
+// того уровня памяти, в который помещается рабочее множество.
+enum chase_pattern { CHASE_SEQUENTIAL, CHASE_REVERSE, CHASE_RANDOM, CHASE_PATTERNS };
+
+extern const char *const chase_pattern_names[CHASE_PATTERNS];
+
+struct chase_point {
+    size_t bytes;                       // рабочее множество
+    double ns[CHASE_PATTERNS];          // на один переход
+    double cycles[CHASE_PATTERNS];      // тактов TSC на один переход
+    // Такты ядра и промахи на переход по аппаратным счётчикам
+    // (common/perf.h); NAN, если счётчиков нет
+    double core_cycles[CHASE_PATTERNS];
+    double l1d_misses[CHASE_PATTERNS], llc_misses[CHASE_PATTERNS], dtlb_misses[CHASE_PATTERNS];
+};
+
+// Плато задержки на кривой: уровень иерархии и его размер
+struct chase_level {
+    char name[24];          // L1, L2, ... или DRAM
+    size_t bytes;           // последний размер на плато (для DRAM — 0)
+    double ns, cycles;      // медиана по плато
+};
+
+// Страницы буфера:
+//   system  — как решит ядро (THP по /sys/kernel/mm/transparent_hugepage);
+//   4k      — только обычные страницы (MADV_NOHUGEPAGE);
+//   thp     — прозрачные огромные страницы (MADV_HUGEPAGE);
+//   hugetlb — MAP_HUGETLB из заранее выделенного пула vm.nr_hugepages.
+enum chase_pages { CHASE_PAGES_SYSTEM, CHASE_PAGES_4K, CHASE_PAGES_THP, CHASE_PAGES_HUGETLB };
+#define CHASE_PAGE_MODES 4
+
+extern const char *const chase_pages_names[CHASE_PAGE_MODES];
+
+#define CHASE_PAGE 4096
+#define CHASE_HUGE_PAGE (2u << 20)
+
+// Буфер под max_bytes, выровненный на огромную страницу; NULL, если
+// памяти (или огромных страниц в пуле) нет
+void *chase_alloc(size_t max_bytes, enum chase_pages pages);
+void chase_free(void *buffer, size_t max_bytes);
+
+// "system", "4k", "thp", "hugetlb"; 0, если имя неизвестно
+int chase_parse_pages(const char *s, enum chase_pages *pages);
+
+// Сколько памяти процесса сейчас отображено огромными страницами:
+// madvise — лишь просьба, и ядро может её не выполнить
+size_t chase_huge_bytes(void);
+
+// Цепочка из nodes узлов по stride байт в начале base; случайная —
+// один цикл (алгоритм Саттоло), чтобы обход проходил все узлы
+void chase_build(char *base, size_t nodes, size_t stride, enum chase_pattern pattern,
+                 uint64_t seed);
+
+// Случайный цикл по pages страницам размера page, по узлу на страницу:
+// каждый переход — другая страница, а строк в кэше столько же, сколько
+// страниц. Одинаковая раскладка на обычных и огромных страницах
+// отличается только ценой трансляции адресов.
+void chase_build_pages(char *base, size_t pages, size_t page, uint64_t seed);
+
+// hops переходов от base; возвращает нс на переход, *cycles — такты TSC
+// (постоянной частоты, не такты ядра), замер сериализован lfence/rdtscp
+double chase_run(const char *base, size_t hops, double *cycles);
+
+// Независимые цепочки (параллелизм памяти): heads[0..chains) — узлы
+// случайного цикла, построенного chase_build, через nodes / chains шагов
+// друг от друга, так что обходы из них не пересекаются за nodes / chains
+// переходов. chains не больше CHASE_MAX_CHAINS.
+#define CHASE_MAX_CHAINS 32
+void chase_chain_heads(const char *base, size_t nodes, int chains, const char **heads);
+
+// По hops переходов в каждой из chains цепочек вперемешку; возвращает нс
+// на переход (всех цепочек вместе), *cycles — такты TSC
+double chase_run_chains(const char *const *heads, int chains, size_t hops, double *cycles);
+
+// Размеры от min_bytes до max_bytes с шагом 2^(1/steps_per_octave),
+// кратные stride; возвращает число размеров (не больше max_count)
+size_t chase_sizes(size_t min_bytes, size_t max_bytes, size_t stride, int steps_per_octave,
+                   size_t *sizes, size_t max_count);
+
+// Плато и колени кривой pattern: уровень кончается там, где задержка
+// устойчиво выросла больше чем на CHASE_KNEE_RATIO. Последнее плато
+// называется DRAM, если оно начинается за пределами самого большого кэша
+// из sysfs (или sysfs недоступен), а для замеров короче этого кэша — если
+// оно намного медленнее предыдущего. Возвращает число уровней.
+size_t chase_detect_levels(const struct chase_point *points, size_t count,
+                           enum chase_pattern pattern, struct chase_level *levels,
+                           size_t max_levels);
+
+// Размер кэша данных уровня level по sysfs (для level = 0 — самого
+// большого); 0, если неизвестен
+size_t chase_sysfs_cache(int level);
+
+#endif
@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "coherence.h"
+#include "stream.h"
+#include "../common/tune.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#else
+static int omp_get_thread_num(void) { return 0; }
+#endif
+
+#define COHERENCE_MAX_CPUS 256
+#define ROUND_TRIPS 20000
+#define INCREMENTS (1 << 22)
+#define ATOMIC_INCREMENTS (1 << 20)
+// Соседние строки процессор подтягивает парами, поэтому отступ — две строки
+#define PAD 128
+
+struct padded_counter {
+    _Alignas(PAD) long value;
+};
+
+static double seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+static void cpu_pause(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __asm__ __volatile__("pause");
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+// Нс на круг между ядрами a и b: первый поток пишет нечётное значение
+// и ждёт чётного, второй — наоборот
+static double round_trip(int a, int b)
+{
+    static struct padded_counter flag;
+    double t0 = 0, t1 = 0;
+
+    flag.value = 0;
+    #pragma omp parallel num_threads(2)
+    {
+        int tid = omp_get_thread_num();
+        stream_pin(tid ? b : a);
+        #pragma omp barrier
+        if (tid == 0) {
+            t0 = seconds();
+            for (long k = 0; k < ROUND_TRIPS; ++k) {
+                __atomic_store_n(&flag.value, 2 * k + 1, __ATOMIC_RELEASE);
+                while (__atomic_load_n(&flag.value, __ATOMIC_ACQUIRE) != 2 * k + 2)
+                    cpu_pause();
+            }
+            t1 = seconds();
+        } else {
+            for (long k = 0; k < ROUND_TRIPS; ++k) {
+                while (__atomic_load_n(&flag.value, __ATOMIC_ACQUIRE) != 2 * k + 1)
+                    cpu_pause();
+                __atomic_store_n(&flag.value, 2 * k + 2, __ATOMIC_RELEASE);
+            }
+        }
+    }
+    return (t1 - t0) * 1e9 / ROUND_TRIPS;
+}
+
+// Миллионов увеличений в секунду: threads потоков, каждый — свой
+// счётчик через step long от предыдущего (1 — одна строка на всех)
+static double private_counters(int threads, const int *cpus, int n_cpus, size_t step)
+{
+    long *counters = aligned_alloc(PAD, (threads * step * sizeof(long) + PAD - 1) / PAD * PAD);
+    double t0 = 0, elapsed = 0;
+
+    if (!counters)
+        return 0;
+    #pragma omp parallel num_threads(threads)
+    {
+        int tid = omp_get_thread_num();
+        volatile long *c = counters + tid * step;
+        stream_pin(cpus[tid % n_cpus]);
+        *c = 0;
+        #pragma omp master
+        t0 = seconds();
+        #pragma omp barrier
+        for (long k = 0; k < INCREMENTS; ++k)
+            *c = *c + 1;
+        #pragma omp barrier
+        #pragma omp master
+        elapsed = seconds() - t0;
+    }
+    free(counters);
+    return (double)INCREMENTS * threads / elapsed * 1e-6;
+}
+
+static double shared_atomic(int threads, const int *cpus, int n_cpus)
+{
+    static struct padded_counter counter;
+    double t0 = 0, elapsed = 0;
+
+    counter.value = 0;
+    #pragma omp parallel num_threads(threads)
+    {
+        int tid = omp_get_thread_num();
+        stream_pin(cpus[tid % n_cpus]);
+        #pragma omp master
+        t0 = seconds();
+        #pragma omp barrier
+        for (long k = 0; k < ATOMIC_INCREMENTS; ++k)
+            __atomic_fetch_add(&counter.value, 1, __ATOMIC_RELAXED);
+        #pragma omp barrier
+        #pragma omp master
+        elapsed = seconds() - t0;
+    }
+    return (double)ATOMIC_INCREMENTS * threads / elapsed * 1e-6;
+}
+
+int coherence_benchmark(const struct coherence_options *opt)
+{
+    static int cpus[COHERENCE_MAX_CPUS];
+    int n = stream_cpus(cpus, COHERENCE_MAX_CPUS);
+    double *matrix = calloc((size_t)n * n, sizeof(double));
+    double (*counters)[3] = calloc(opt->thread_counts, sizeof(*counters));
+    char host[256];
+    FILE *csv, *f;
+
+    if (n < 1 || !matrix || !counters) {
+        free(matrix); free(counters);
+        return 1;
+    }
+
+    // На одном ядре круг — это переключения планировщика, не когерентность
+    if (n < 2)
+        fprintf(stderr, "Only one CPU available: skipping the core-to-core matrix\n");
+    for (int i = 0; i < n; ++i)
+        for (int j = i + 1; j < n; ++j) {
+            matrix[i * n + j] = matrix[j * n + i] = round_trip(cpus[i], cpus[j]);
+            printf("cpu %3d <-> cpu %3d: %8.1f ns round trip\n", cpus[i], cpus[j],
+                   matrix[i * n + j]);
+        }
+    fflush(stdout);
+
+    for (size_t t = 0; t < opt->thread_counts; ++t) {
+        int threads = opt->threads[t];
+        counters[t][0] = private_counters(threads, cpus, n, 1);
+        counters[t][1] = private_counters(threads, cpus, n, PAD / sizeof(long));
+        counters[t][2] = shared_atomic(threads, cpus, n);
+        printf("%3d threads: shared line %8.1f, padded %8.1f, atomic %8.1f Mops/s\n",
+               threads, counters[t][0], counters[t][1], counters[t][2]);
+        fflush(stdout);
+    }
+
+    if ((csv = fopen(opt->csv_path, "w")) != NULL) {
+        fprintf(csv, "From,To,Round trip ns\n");
+        for (int i = 0; i < n; ++i)
+            for (int j = 0; j < n; ++j)
+                if (i != j)
+                    fprintf(csv, "%d,%d,%.1f\n", cpus[i], cpus[j], matrix[i * n + j]);
+        fclose(csv);
+    } else {
+        perror(opt->csv_path);
+    }
+
+    if ((f = fopen(opt->report_path, "w")) != NULL) {
+        tune_host(host, sizeof(host));
+        fprintf(f, "{\n  \"host\": \"%s\",\n  \"cpus\": [", host);
+        for (int i = 0; i < n; ++i)
+            fprintf(f, "%s%d", i ? ", " : "", cpus[i]);
+        // Строка i — задержки от cpus[i]; на диагонали null
+        fprintf(f, "],\n  \"round_trip_ns\": [");
+        for (int i = 0; i < n; ++i) {
+            fprintf(f, "%s\n    [", i ? "," : "");
+            for (int j = 0; j < n; ++j) {
+                if (i == j)
+                    fprintf(f, "%snull", j ? ", " : "");
+                else
+                    fprintf(f, "%s%.1f", j ? ", " : "", matrix[i * n + j]);
+            }
+            fprintf(f, "]");
+        }
+        fprintf(f, "\n  ],\n  \"counters\": [");
+        for (size_t t = 0; t < opt->thread_counts; ++t)
+            fprintf(f, "%s\n    {\"threads\": %d, \"false_sharing_mops\": %.3f, "
+                       "\"padded_mops\": %.3f, \"atomic_mops\": %.3f}",
+                    t ? "," : "", opt->threads[t], counters[t][0], counters[t][1],
+                    counters[t][2]);
+        fprintf(f, "\n  ]\n}\n");
+        fclose(f);
+    } else {
+        perror(opt->report_path);
+    }
+
+    free(matrix);
+    free(counters);
+    return 0;
+}
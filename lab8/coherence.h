@@ -0,0 +1,22 @@
+#ifndef LAB8_COHERENCE_H
+#define LAB8_COHERENCE_H
+
+#include <stddef.h>
+
+// Цена когерентности кэшей между ядрами:
+//   матрица задержек — два потока на ядрах i и j передают друг другу
+//   флаг в одной строке кэша, время круга туда и обратно;
+//   ложное разделение — каждый поток увеличивает свой счётчик, счётчики
+//   лежат в одной строке или каждый в своей;
+//   общий атомарный счётчик — fetch_add всех потоков в одну переменную.
+struct coherence_options {
+    const int *threads;         // числа потоков для счётчиков
+    size_t thread_counts;
+    const char *csv_path;       // матрица задержек
+    const char *report_path;
+};
+
+// Возвращает 0 при успехе
+int coherence_benchmark(const struct coherence_options *opt);
+
+#endif
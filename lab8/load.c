@@ -0,0 +1,255 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "load.h"
+#include "chase.h"
+#include "stream.h"
+#include "../common/tune.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#else
+static int omp_get_thread_num(void) { return 0; }
+#endif
+
+#define LOAD_HOPS (1 << 22)
+#define LOAD_MAX_CPUS 1024
+// Поток нагрузки читает блок и ждёт delay пауз; -1 — потоки стоят
+#define LOAD_BLOCK_DOUBLES 512
+// Независимые суммы: одна цепочка сложений ограничила бы чтение
+// задержкой сложения, а не памятью
+#define LOAD_SUMS 8
+
+static const int chain_counts[] = { 1, 2, 3, 4, 6, 8, 12, 16, 24, 32 };
+#define CHAIN_COUNTS (sizeof(chain_counts) / sizeof(chain_counts[0]))
+
+static const int delays[] = { -1, 4096, 1024, 256, 64, 16, 4, 0 };
+#define DELAYS (sizeof(delays) / sizeof(delays[0]))
+
+struct mlp_point {
+    int chains;
+    double ns, cycles, gbs;
+};
+
+struct loaded_point {
+    int delay;
+    double gbs, ns, cycles;
+};
+
+volatile double load_sink;
+
+static double seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+static void cpu_pause(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __asm__ __volatile__("pause");
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+// Читает свой кусок по кругу, пока *stop не станет ненулевым;
+// возвращает прочитанные байты, *elapsed — время работы
+static double generate(const double *chunk, size_t count, int delay, const int *stop,
+                       double *elapsed)
+{
+    double sums[LOAD_SUMS] = {0}, bytes = 0, t0 = seconds();
+    size_t i = 0;
+
+    while (!__atomic_load_n(stop, __ATOMIC_RELAXED)) {
+        for (size_t j = 0; j < LOAD_BLOCK_DOUBLES; j += LOAD_SUMS)
+            for (size_t s = 0; s < LOAD_SUMS; ++s)
+                sums[s] += chunk[i + j + s];
+        bytes += LOAD_BLOCK_DOUBLES * sizeof(double);
+        i += LOAD_BLOCK_DOUBLES;
+        if (i + LOAD_BLOCK_DOUBLES > count)
+            i = 0;
+        for (int d = 0; d < delay; ++d)
+            cpu_pause();
+    }
+    *elapsed = seconds() - t0;
+
+    double sum = 0;
+    for (size_t s = 0; s < LOAD_SUMS; ++s)
+        sum += sums[s];
+    load_sink = sum;
+    return bytes;
+}
+
+static void run_mlp(const char *chain, size_t nodes, size_t stride, struct mlp_point *points)
+{
+    const char *heads[CHASE_MAX_CHAINS];
+
+    for (size_t i = 0; i < CHAIN_COUNTS; ++i) {
+        struct mlp_point *p = &points[i];
+        p->chains = chain_counts[i];
+        chase_chain_heads(chain, nodes, p->chains, heads);
+        chase_run_chains(heads, p->chains, nodes / p->chains, NULL);
+        p->ns = chase_run_chains(heads, p->chains, LOAD_HOPS / p->chains, &p->cycles);
+        // Каждый переход приносит строку из stride байт
+        p->gbs = stride / p->ns;
+        printf("%2d chains: %7.2f ns, %7.1f cycles per access, MLP %5.2f, %6.2f GB/s\n",
+               p->chains, p->ns, p->cycles, points[0].ns / p->ns, p->gbs);
+        fflush(stdout);
+    }
+}
+
+static void run_loaded(const char *chain, double *buffer, size_t buffer_doubles, int gens,
+                       const int *cpus, int n_cpus, struct loaded_point *points)
+{
+    size_t chunk = buffer_doubles / gens / LOAD_BLOCK_DOUBLES * LOAD_BLOCK_DOUBLES;
+    double *bytes = calloc(gens + 1, sizeof(double));
+    double *times = calloc(gens + 1, sizeof(double));
+
+    if (!bytes || !times) {
+        free(bytes); free(times);
+        return;
+    }
+
+    for (size_t d = 0; d < DELAYS; ++d) {
+        struct loaded_point *p = &points[d];
+        int stop = 0;
+
+        p->delay = delays[d];
+        #pragma omp parallel num_threads(gens + 1)
+        {
+            int tid = omp_get_thread_num();
+            if (n_cpus > 0)
+                stream_pin(cpus[tid % n_cpus]);
+            bytes[tid] = times[tid] = 0;
+            // Первое касание — в своём потоке, на своём узле
+            if (tid > 0 && d == 0)
+                memset(buffer + (tid - 1) * chunk, 0, chunk * sizeof(double));
+            #pragma omp barrier
+            if (tid == 0) {
+                chase_run(chain, LOAD_HOPS / 4, NULL);
+                p->ns = chase_run(chain, LOAD_HOPS, &p->cycles);
+                __atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+            } else if (p->delay >= 0) {
+                bytes[tid] = generate(buffer + (tid - 1) * chunk, chunk, p->delay, &stop,
+                                      &times[tid]);
+            }
+        }
+
+        p->gbs = 0;
+        for (int t = 1; t <= gens; ++t)
+            if (times[t] > 0)
+                p->gbs += bytes[t] / times[t] * 1e-9;
+        if (p->delay < 0)
+            printf("idle load:        %7.2f GB/s, latency %7.2f ns, %7.1f cycles\n",
+                   p->gbs, p->ns, p->cycles);
+        else
+            printf("delay %5d:      %7.2f GB/s, latency %7.2f ns, %7.1f cycles\n",
+                   p->delay, p->gbs, p->ns, p->cycles);
+        fflush(stdout);
+    }
+    free(bytes);
+    free(times);
+}
+
+static void write_report(const struct load_options *opt, int gens,
+                         const struct mlp_point *mlp, const struct loaded_point *loaded)
+{
+    char host[256], node[256];
+    FILE *f = fopen(opt->report_path, "w");
+
+    if (!f) {
+        perror(opt->report_path);
+        return;
+    }
+    tune_host(host, sizeof(host));
+    if (gethostname(node, sizeof(node)) != 0)
+        snprintf(node, sizeof(node), "localhost");
+    node[sizeof(node) - 1] = '\0';
+
+    fprintf(f, "{\n  \"host\": \"%s\",\n  \"node\": \"%s\",\n", host, node);
+    fprintf(f, "  \"stride_bytes\": %zu,\n  \"max_bytes\": %zu", opt->stride, opt->max_bytes);
+    if (opt->mlp) {
+        fprintf(f, ",\n  \"mlp\": [");
+        for (size_t i = 0; i < CHAIN_COUNTS; ++i)
+            fprintf(f, "%s\n    {\"chains\": %d, \"ns\": %.3f, \"cycles\": %.3f, "
+                       "\"mlp\": %.3f, \"gbs\": %.3f}",
+                    i ? "," : "", mlp[i].chains, mlp[i].ns, mlp[i].cycles,
+                    mlp[0].ns / mlp[i].ns, mlp[i].gbs);
+        fprintf(f, "\n  ]");
+    }
+    if (opt->loaded) {
+        fprintf(f, ",\n  \"load_threads\": %d,\n  \"loaded_latency\": [", gens);
+        for (size_t i = 0; i < DELAYS; ++i)
+            fprintf(f, "%s\n    {\"delay\": %d, \"gbs\": %.3f, \"ns\": %.3f, \"cycles\": %.3f}",
+                    i ? "," : "", loaded[i].delay, loaded[i].gbs, loaded[i].ns,
+                    loaded[i].cycles);
+        fprintf(f, "\n  ]");
+    }
+    fprintf(f, "\n}\n");
+    fclose(f);
+}
+
+int load_benchmark(const struct load_options *opt)
+{
+    static int cpus[LOAD_MAX_CPUS];
+    int n_cpus = stream_cpus(cpus, LOAD_MAX_CPUS);
+    int gens = opt->load_threads > 0 ? opt->load_threads : n_cpus - 1;
+    struct mlp_point mlp[CHAIN_COUNTS];
+    struct loaded_point loaded[DELAYS];
+    // Половина — цепочке, половина — потокам нагрузки
+    size_t chain_bytes = opt->loaded ? opt->max_bytes / 2 / 4096 * 4096 : opt->max_bytes;
+    size_t nodes = chain_bytes / opt->stride;
+    char *buffer = chase_alloc(opt->max_bytes, CHASE_PAGES_SYSTEM);
+    FILE *f;
+
+    if (!buffer) {
+        fprintf(stderr, "Memory allocation failed for %zu bytes\n", opt->max_bytes);
+        return 1;
+    }
+    if (nodes < 2 * CHASE_MAX_CHAINS) {
+        fprintf(stderr, "Working set is too small for %d chains\n", CHASE_MAX_CHAINS);
+        chase_free(buffer, opt->max_bytes);
+        return 1;
+    }
+    chase_build(buffer, nodes, opt->stride, CHASE_RANDOM, 1);
+
+    if (opt->mlp) {
+        run_mlp(buffer, nodes, opt->stride, mlp);
+        if ((f = fopen("mlp.csv", "w")) != NULL) {
+            fprintf(f, "Chains,ns,Cycles,MLP,GB/s\n");
+            for (size_t i = 0; i < CHAIN_COUNTS; ++i)
+                fprintf(f, "%d,%.3f,%.3f,%.3f,%.3f\n", mlp[i].chains, mlp[i].ns,
+                        mlp[i].cycles, mlp[0].ns / mlp[i].ns, mlp[i].gbs);
+            fclose(f);
+        }
+    }
+
+    if (opt->loaded) {
+        // На одном процессоре нагрузка делит его с замером и кривая
+        // показывает планировщик, а не память
+        if (gens < 1) {
+            fprintf(stderr, "Only one CPU available: load threads share it with the chase\n");
+            gens = 1;
+        }
+        run_loaded(buffer, (double *)(buffer + chain_bytes),
+                   (opt->max_bytes - chain_bytes) / sizeof(double), gens, cpus, n_cpus,
+                   loaded);
+        if ((f = fopen("loaded_latency.csv", "w")) != NULL) {
+            fprintf(f, "Delay,Threads,GB/s,ns,Cycles\n");
+            for (size_t i = 0; i < DELAYS; ++i)
+                fprintf(f, "%d,%d,%.3f,%.3f,%.3f\n", loaded[i].delay, gens, loaded[i].gbs,
+                        loaded[i].ns, loaded[i].cycles);
+            fclose(f);
+        }
+    }
+
+    chase_free(buffer, opt->max_bytes);
+    write_report(opt, gens, mlp, loaded);
+    return 0;
+}
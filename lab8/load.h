@@ -0,0 +1,24 @@
+#ifndef LAB8_LOAD_H
+#define LAB8_LOAD_H
+
+#include <stddef.h>
+
+// Задержка памяти не одной цепочкой, а под нагрузкой:
+//   mlp    — K независимых случайных цепочек (K = 1..CHASE_MAX_CHAINS)
+//            вперемешку: сколько промахов ядро держит в полёте;
+//   loaded — один поток обходит цепочку, остальные читают память с
+//            паузой между блоками, задавая давление на полосу: кривая
+//            задержка — пропускная способность.
+struct load_options {
+    size_t max_bytes;           // цепочка и буферы нагрузки вместе
+    size_t stride;
+    int mlp, loaded;
+    int load_threads;           // потоков нагрузки; 0 — все процессоры, кроме одного
+    const char *report_path;
+};
+
+// Пишет mlp.csv, loaded_latency.csv и отчёт JSON с отпечатком машины.
+// Возвращает 0 при успехе.
+int load_benchmark(const struct load_options *opt);
+
+#endif
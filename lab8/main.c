@@ -1,130 +1,346 @@
+// Сборка: gcc -O3 -fopenmp main.c mult.c chase.c stream.c load.c coherence.c tlb.c ../common/tune.c
+//         ../common/perf.c -o lab8 -lm
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <time.h>
+#include <math.h>
 
-#define NMIN 256
-#define NMAX (32 * 1024 * 1024 / sizeof(int))
-#define REPEATS 100
+#include "mult.h"
+#include "chase.h"
+#include "stream.h"
+#include "load.h"
+#include "coherence.h"
+#include "tlb.h"
+#include "../common/perf.h"
 
-#if defined(_MSC_VER)
-#include <intrin.h>
-uint64_t rdtsc() {
-    return __rdtsc();
-}
-#elif defined(__GNUC__) || defined(__clang__)
-uint64_t rdtsc() {
-    unsigned int lo, hi;
-    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
-    return ((uint64_t)hi << 32) | lo;
-}
+#ifdef _OPENMP
+#include <omp.h>
 #else
-#error "RDTSC not supported on this platform"
+static int omp_get_max_threads(void) { return 1; }
 #endif
 
-void multMatrix() 
+#define MIN_BYTES 1024
+#define DEFAULT_MAX_BYTES (1ULL << 30)
+#define STEPS_PER_OCTAVE 4
+// Не меньше стольких переходов на замер, даже если узлов мало
+#define MIN_HOPS (1 << 20)
+#define MAX_POINTS 256
+#define MAX_LEVELS 8
+#define MAX_THREAD_COUNTS 32
+
+void multMatrix(int tune) 
 { 
     const size_t size = 2048; 
     float *A = malloc(size * size * sizeof(float)); 
     float *B = malloc(size * size * sizeof(float)); 
-    float *C = calloc(size * size, sizeof(float)); 
-    for (size_t i = 0; i < size; i++) 
-        for (size_t k = 0; k < size; k++) 
-        { 
-        float a = A[i * size + k]; 
-        for (size_t j = 0; j < size; j++) 
-            C[i * size + j] += a * B[k * size + j]; 
-        } 
+    float *C = malloc(size * size * sizeof(float)); 
+    struct mult_config cfg;
+    struct perf_region region = {0};
+    struct perf_sample sample;
+
+    if (!A || !B || !C) {
+        free(A); free(B); free(C);
+        return;
+    }
+    // Детерминированные значения: результат можно сравнить между запусками
+    for (size_t i = 0; i < size * size; i++) {
+        A[i] = (float)(i % 7) / 7.0f;
+        B[i] = (float)(i % 5) / 5.0f;
+    }
+
+    mult_autotune(&cfg, size, tune);
+    perf_begin(&region);
+    mult_run(&cfg, size, size, A, B, C);
+    perf_end(&region, &sample);
+    perf_close(&region);
+
+    double elapsed = sample.seconds;
+    printf("multMatrix: order %s, tile %zu, unroll %d, %d threads: %.3f s, %.2f GFLOP/s\n",
+           mult_order_names[cfg.order], cfg.tile, cfg.unroll, cfg.threads, elapsed,
+           2.0 * size * size * size / elapsed * 1e-9);
+    perf_print(stdout, "multMatrix counters (main thread)", &sample);
     printf("%f %f %f\n", C[0], C[size * size - 1], C[size + 1]); 
     free(A); 
     free(B); 
     free(C); 
 }
 
-void fill_sequential(int *array, int size) {
-    for (int i = 0; i < size - 1; i++) {
-        array[i] = i + 1;
-    }
-    array[size - 1] = 0;
+// "64", "32K", "4G" — байты
+static size_t parse_bytes(const char *s)
+{
+    char *end;
+    size_t v = strtoull(s, &end, 10);
+    if (*end == 'K' || *end == 'k') v <<= 10;
+    else if (*end == 'M' || *end == 'm') v <<= 20;
+    else if (*end == 'G' || *end == 'g') v <<= 30;
+    return v;
 }
 
-void fill_reverse(int *array, int size) {
-    for (int i = 0; i < size; i++) {
-        array[i] = (i - 1 + size) % size;
+static void write_report(const char *path, size_t stride, size_t max_bytes,
+                         const struct chase_point *points, size_t count,
+                         const struct chase_level *levels, size_t n_levels)
+{
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return;
     }
+
+    fprintf(f, "{\n  \"stride_bytes\": %zu,\n  \"max_bytes\": %zu,\n", stride, max_bytes);
+    fprintf(f, "  \"sysfs_largest_cache_bytes\": %zu,\n", chase_sysfs_cache(0));
+    fprintf(f, "  \"levels\": [");
+    for (size_t i = 0; i < n_levels; ++i)
+        fprintf(f, "%s\n    {\"name\": \"%s\", \"size_bytes\": %zu, \"latency_ns\": %.3f, "
+                   "\"latency_cycles\": %.3f}",
+                i ? "," : "", levels[i].name, levels[i].bytes, levels[i].ns, levels[i].cycles);
+    fprintf(f, "\n  ],\n  \"points\": [");
+    for (size_t i = 0; i < count; ++i) {
+        fprintf(f, "%s\n    {\"bytes\": %zu", i ? "," : "", points[i].bytes);
+        for (int p = 0; p < CHASE_PATTERNS; ++p) {
+            const char *name = chase_pattern_names[p];
+            fprintf(f, ", \"%s_ns\": %.3f, \"%s_cycles\": %.3f",
+                    name, points[i].ns[p], name, points[i].cycles[p]);
+            // Счётчики пишутся, только если они есть
+            if (!isnan(points[i].core_cycles[p]))
+                fprintf(f, ", \"%s_core_cycles\": %.3f", name, points[i].core_cycles[p]);
+            if (!isnan(points[i].l1d_misses[p]))
+                fprintf(f, ", \"%s_l1d_misses\": %.4f", name, points[i].l1d_misses[p]);
+            if (!isnan(points[i].llc_misses[p]))
+                fprintf(f, ", \"%s_llc_misses\": %.4f", name, points[i].llc_misses[p]);
+            if (!isnan(points[i].dtlb_misses[p]))
+                fprintf(f, ", \"%s_dtlb_misses\": %.4f", name, points[i].dtlb_misses[p]);
+        }
+        fprintf(f, "}");
+    }
+    fprintf(f, "\n  ]\n}\n");
+    fclose(f);
+}
+
+static double per_hop(const struct perf_sample *s, enum perf_event_id e, size_t hops)
+{
+    return s->valid[e] ? s->value[e] / hops : NAN;
 }
 
-void fill_random(int *array, int size) {
-    for (int i = 0; i < size; i++) {
-        array[i] = i;
+// Задержка обхода для рабочих множеств от MIN_BYTES до max_bytes тремя
+// способами; CSV — такты на переход, уровни ищутся по случайному обходу
+static int profile(size_t max_bytes, size_t stride, enum chase_pages pages,
+                   const char *report_path)
+{
+    static const char *csv_names[CHASE_PATTERNS] = {
+        "direct_cycles.csv", "reverse_cycles.csv", "random_cycles.csv"
+    };
+    size_t sizes[MAX_POINTS];
+    struct chase_point points[MAX_POINTS];
+    struct chase_level levels[MAX_LEVELS];
+    FILE *csv[CHASE_PATTERNS] = { NULL, NULL, NULL };
+    struct perf_region region = {0};
+    struct perf_sample sample;
+
+    size_t count = chase_sizes(MIN_BYTES, max_bytes, stride, STEPS_PER_OCTAVE, sizes, MAX_POINTS);
+    char *buffer = chase_alloc(max_bytes, pages);
+    if (!buffer) {
+        fprintf(stderr, "Memory allocation failed for %zu bytes\n", max_bytes);
+        return 1;
     }
-    for (int i = 0; i < size; i++) {
-        int j = rand() % size;
-        int temp = array[i];
-        array[i] = array[j];
-        array[j] = temp;
+
+    for (int p = 0; p < CHASE_PATTERNS; ++p) {
+        csv[p] = fopen(csv_names[p], "w");
+        if (!csv[p]) {
+            fprintf(stderr, "Error opening output files\n");
+            for (int q = 0; q < p; ++q)
+                fclose(csv[q]);
+            chase_free(buffer, max_bytes);
+            return 1;
+        }
+        fprintf(csv[p], "Size,%s\n", chase_pattern_names[p]);
     }
-}
 
-uint64_t measure_cycles(int *array, int size) {
-    volatile int k = 0;
-    uint64_t start = rdtsc();
-    for (int r = 0; r < REPEATS; r++) {
-        for (int i = 0; i < size; i++) {
-            k = array[k];
+    for (size_t i = 0; i < count; ++i) {
+        size_t nodes = sizes[i] / stride;
+        size_t hops = nodes > MIN_HOPS ? nodes : MIN_HOPS;
+
+        points[i].bytes = sizes[i];
+        for (int p = 0; p < CHASE_PATTERNS; ++p) {
+            chase_build(buffer, nodes, stride, p, i + 1);
+            // Первый проход приводит узлы в кэш (или вытесняет прежние)
+            chase_run(buffer, nodes, NULL);
+            perf_begin(&region);
+            points[i].ns[p] = chase_run(buffer, hops, &points[i].cycles[p]);
+            perf_end(&region, &sample);
+            points[i].core_cycles[p] = per_hop(&sample, PERF_CYCLES, hops);
+            points[i].l1d_misses[p] = per_hop(&sample, PERF_L1D_MISSES, hops);
+            points[i].llc_misses[p] = per_hop(&sample, PERF_LLC_MISSES, hops);
+            points[i].dtlb_misses[p] = per_hop(&sample, PERF_DTLB_MISSES, hops);
+            fprintf(csv[p], "%zu,%.3f\n", sizes[i], points[i].cycles[p]);
         }
+        printf("%12zu B: linear %7.2f ns, reverse %7.2f ns, random %7.2f ns\n", sizes[i],
+               points[i].ns[CHASE_SEQUENTIAL], points[i].ns[CHASE_REVERSE],
+               points[i].ns[CHASE_RANDOM]);
+        if (!isnan(points[i].core_cycles[CHASE_RANDOM]))
+            printf("%12s    random: %.1f core cycles, %.3f LLC and %.3f dTLB misses per hop\n",
+                   "", points[i].core_cycles[CHASE_RANDOM], points[i].llc_misses[CHASE_RANDOM],
+                   points[i].dtlb_misses[CHASE_RANDOM]);
+        fflush(stdout);
+    }
+
+    for (int p = 0; p < CHASE_PATTERNS; ++p)
+        fclose(csv[p]);
+    chase_free(buffer, max_bytes);
+    perf_close(&region);
+
+    size_t largest = chase_sysfs_cache(0);
+    if (largest && max_bytes < 2 * largest)
+        fprintf(stderr, "Warning: --max is below twice the last cache level (%zu B); "
+                        "memory is recognised by latency only\n", largest);
+    size_t n_levels = chase_detect_levels(points, count, CHASE_RANDOM, levels, MAX_LEVELS);
+    for (size_t i = 0; i < n_levels; ++i) {
+        if (levels[i].bytes)
+            printf("%-4s up to %10zu B: %7.2f ns, %7.1f cycles\n", levels[i].name,
+                   levels[i].bytes, levels[i].ns, levels[i].cycles);
+        else
+            printf("%-4s                 : %7.2f ns, %7.1f cycles\n", levels[i].name,
+                   levels[i].ns, levels[i].cycles);
     }
-    uint64_t end = rdtsc();
-    return (end - start);
+
+    write_report(report_path, stride, max_bytes, points, count, levels, n_levels);
+    return 0;
 }
 
-int main() {
-    multMatrix();
+// Степени двойки до max и само max, если оно не степень двойки
+static size_t default_threads(int *threads, int max)
+{
+    size_t count = 0;
+    for (int t = 1; t < max && count < MAX_THREAD_COUNTS - 1; t *= 2)
+        threads[count++] = t;
+    threads[count++] = max;
+    return count;
+}
 
-    FILE *file_direct = fopen("direct_cycles.csv", "w");
-    FILE *file_reverse = fopen("reverse_cycles.csv", "w");
-    FILE *file_random = fopen("random_cycles.csv", "w");
+// "1,2,8" — числа потоков
+static size_t parse_threads(const char *s, int *threads)
+{
+    size_t count = 0;
+    char *end;
 
-    if (!file_direct || !file_reverse || !file_random) {
-        fprintf(stderr, "Error opening output files\n");
-        exit(EXIT_FAILURE);
+    while (*s && count < MAX_THREAD_COUNTS) {
+        long v = strtol(s, &end, 10);
+        if (end == s) break;
+        if (v > 0) threads[count++] = (int)v;
+        if (*end != ',') break;
+        s = end + 1;
     }
+    return count;
+}
 
-    fprintf(file_direct, "Size (elements), Cycles per element\n");
-    fprintf(file_reverse, "Size (elements), Cycles per element\n");
-    fprintf(file_random, "Size (elements), Cycles per element\n");
+int main(int argc, char *argv[]) {
+    int tune = 0, mult = 1, stream = 0, coherence = 0, tlb = 0;
+    enum chase_pages pages = CHASE_PAGES_SYSTEM;
+    struct load_options load = { .report_path = "memory_load.json" };
+    int threads[MAX_THREAD_COUNTS];
+    size_t thread_counts = 0;
+    double peak_gflops = 0;
+    const char *stream_report = "bandwidth.json";
+    size_t max_bytes = DEFAULT_MAX_BYTES;
+    size_t stride = 64;
+    const char *report = "hierarchy.json";
 
-    for (int size = NMIN; size <= NMAX; size *= 1.2) {
-        int *array = (int *)malloc(size * sizeof(int));
-        if (!array) {
-            fprintf(stderr, "Memory allocation failed for size %d\n", size);
-            exit(EXIT_FAILURE);
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--tune") == 0) {
+            // Подобрать конфигурацию multMatrix заново, даже если она есть в кэше
+            tune = 1;
+        } else if (strcmp(argv[i], "--no-mult") == 0) {
+            mult = 0;
+        } else if (strncmp(argv[i], "--max=", 6) == 0) {
+            max_bytes = parse_bytes(argv[i] + 6);
+        } else if (strncmp(argv[i], "--stride=", 9) == 0) {
+            // Шаг между узлами; по умолчанию — строка кэша
+            stride = parse_bytes(argv[i] + 9);
+        } else if (strncmp(argv[i], "--report=", 9) == 0) {
+            report = argv[i] + 9;
+        } else if (strcmp(argv[i], "--stream") == 0) {
+            // Пропускная способность STREAM вместо задержек
+            stream = 1;
+        } else if (strncmp(argv[i], "--threads=", 10) == 0) {
+            thread_counts = parse_threads(argv[i] + 10, threads);
+        } else if (strncmp(argv[i], "--peak-gflops=", 14) == 0) {
+            // Пик процессора: с ним в отчёт пишутся точки перегиба roofline
+            peak_gflops = atof(argv[i] + 14);
+        } else if (strncmp(argv[i], "--stream-report=", 16) == 0) {
+            stream_report = argv[i] + 16;
+        } else if (strncmp(argv[i], "--pages=", 8) == 0) {
+            // system, 4k, thp, hugetlb
+            if (!chase_parse_pages(argv[i] + 8, &pages)) {
+                fprintf(stderr, "Unknown page mode %s\n", argv[i] + 8);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--tlb") == 0) {
+            // Охват TLB и цена обхода таблиц страниц
+            tlb = 1;
+        } else if (strcmp(argv[i], "--coherence") == 0) {
+            // Задержки между ядрами, ложное разделение, общий атомарный счётчик
+            coherence = 1;
+        } else if (strcmp(argv[i], "--mlp") == 0) {
+            // Задержка при K независимых цепочках
+            load.mlp = 1;
+        } else if (strcmp(argv[i], "--loaded") == 0) {
+            // Задержка под нагрузкой остальных потоков на память
+            load.loaded = 1;
+        } else if (strncmp(argv[i], "--load-threads=", 15) == 0) {
+            load.load_threads = atoi(argv[i] + 15);
+        } else if (strncmp(argv[i], "--load-report=", 14) == 0) {
+            load.report_path = argv[i] + 14;
         }
+    }
 
-        // Прямой обход
-        fill_sequential(array, size);
-        uint64_t cycles_direct = measure_cycles(array, size);
-        double cycles_per_element_direct = (double)cycles_direct / (size * REPEATS);
-        fprintf(file_direct, "%d, %.3f\n", size, cycles_per_element_direct);
-
-        // Обратный обход
-        fill_reverse(array, size);
-        uint64_t cycles_reverse = measure_cycles(array, size);
-        double cycles_per_element_reverse = (double)cycles_reverse / (size * REPEATS);
-        fprintf(file_reverse, "%d, %.3f\n", size, cycles_per_element_reverse);
-
-        // Случайный обход
-        fill_random(array, size);
-        uint64_t cycles_random = measure_cycles(array, size);
-        double cycles_per_element_random = (double)cycles_random / (size * REPEATS);
-        fprintf(file_random, "%d, %.3f\n", size, cycles_per_element_random);
-
-        free(array);
+    if (stride < sizeof(void *) || stride % sizeof(void *) != 0) {
+        fprintf(stderr, "Stride must be a multiple of %zu bytes\n", sizeof(void *));
+        return 1;
     }
+    if (max_bytes < MIN_BYTES)
+        max_bytes = MIN_BYTES;
 
-    fclose(file_direct);
-    fclose(file_reverse);
-    fclose(file_random);
+    if (mult)
+        multMatrix(tune);
 
-    return 0;
+    if (!thread_counts)
+        thread_counts = default_threads(threads, omp_get_max_threads());
+
+    if (stream) {
+        struct stream_options opt = {
+            .max_bytes = max_bytes,
+            .threads = threads,
+            .thread_counts = thread_counts,
+            .peak_gflops = peak_gflops,
+            .csv_path = "stream.csv",
+            .report_path = stream_report,
+        };
+        return stream_benchmark(&opt);
+    }
+    if (tlb) {
+        struct tlb_options opt = {
+            .max_bytes = max_bytes,
+            .pages = pages,
+            .csv_path = "tlb.csv",
+            .report_path = "tlb.json",
+        };
+        return tlb_benchmark(&opt);
+    }
+    if (coherence) {
+        struct coherence_options opt = {
+            .threads = threads,
+            .thread_counts = thread_counts,
+            .csv_path = "coherence_matrix.csv",
+            .report_path = "coherence.json",
+        };
+        return coherence_benchmark(&opt);
+    }
+    if (load.mlp || load.loaded) {
+        load.max_bytes = max_bytes;
+        load.stride = stride;
+        return load_benchmark(&load);
+    }
+
+    return profile(max_bytes, stride, pages, report);
 }
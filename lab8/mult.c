@@ -0,0 +1,251 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mult.h"
+#include "../common/tune.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#else
+static int omp_get_max_threads(void) { return 1; }
+#endif
+
+// Замер идёт на полосе из TUNE_ROWS строк на поток. С тайлами потоки
+// берут блоки по tile строк, и полоса из целых блоков ведёт себя в кэше
+// так же, как вся матрица, а плохие порядки циклов замеряются секундами,
+// а не минутами. Без тайлов это не так, и замер идёт на всей матрице.
+#define TUNE_ROWS 128
+#define TUNE_REPEATS 2
+
+const char *const mult_order_names[ORDER_COUNT] = { "ijk", "ikj", "jik", "jki", "kij", "kji" };
+
+// y[t * sy] += s * x[t * sx] для t < len, с развёрткой на unroll
+static void axpy(size_t len, float s, const float *x, size_t sx, float *y, size_t sy, int unroll)
+{
+    size_t t = 0;
+
+#define AXPY(u) y[(t + u) * sy] += s * x[(t + u) * sx];
+    switch (unroll) {
+    case 8:
+        for (; t + 8 <= len; t += 8) { AXPY(0) AXPY(1) AXPY(2) AXPY(3) AXPY(4) AXPY(5) AXPY(6) AXPY(7) }
+        break;
+    case 4:
+        for (; t + 4 <= len; t += 4) { AXPY(0) AXPY(1) AXPY(2) AXPY(3) }
+        break;
+    case 2:
+        for (; t + 2 <= len; t += 2) { AXPY(0) AXPY(1) }
+        break;
+    }
+#undef AXPY
+
+    // Единичный шаг — отдельный цикл, который компилятор векторизует
+    if (sx == 1 && sy == 1) {
+        for (; t < len; ++t)
+            y[t] += s * x[t];
+    } else {
+        for (; t < len; ++t)
+            y[t * sy] += s * x[t * sx];
+    }
+}
+
+// Сумма x[t] * y[t * sy]; развёртка — независимые частичные суммы
+static float dot(size_t len, const float *x, const float *y, size_t sy, int unroll)
+{
+    float p[8] = {0};
+    size_t t = 0;
+
+#define DOT(u) p[u] += x[t + u] * y[(t + u) * sy];
+    switch (unroll) {
+    case 8:
+        for (; t + 8 <= len; t += 8) { DOT(0) DOT(1) DOT(2) DOT(3) DOT(4) DOT(5) DOT(6) DOT(7) }
+        break;
+    case 4:
+        for (; t + 4 <= len; t += 4) { DOT(0) DOT(1) DOT(2) DOT(3) }
+        break;
+    case 2:
+        for (; t + 2 <= len; t += 2) { DOT(0) DOT(1) }
+        break;
+    }
+#undef DOT
+
+    for (; t < len; ++t)
+        p[0] += x[t] * y[t * sy];
+    return ((p[0] + p[1]) + (p[2] + p[3])) + ((p[4] + p[5]) + (p[6] + p[7]));
+}
+
+// Один тайл [i0, i1) x [j0, j1) x [k0, k1) в заданном порядке циклов
+static void mult_tile(const struct mult_config *cfg, size_t n, const float *A, const float *B,
+                      float *C, size_t i0, size_t i1, size_t j0, size_t j1, size_t k0, size_t k1)
+{
+    int u = cfg->unroll;
+
+    switch (cfg->order) {
+    case ORDER_IJK:
+        for (size_t i = i0; i < i1; ++i)
+            for (size_t j = j0; j < j1; ++j)
+                C[i * n + j] += dot(k1 - k0, A + i * n + k0, B + k0 * n + j, n, u);
+        break;
+    case ORDER_JIK:
+        for (size_t j = j0; j < j1; ++j)
+            for (size_t i = i0; i < i1; ++i)
+                C[i * n + j] += dot(k1 - k0, A + i * n + k0, B + k0 * n + j, n, u);
+        break;
+    case ORDER_IKJ:
+        for (size_t i = i0; i < i1; ++i)
+            for (size_t k = k0; k < k1; ++k)
+                axpy(j1 - j0, A[i * n + k], B + k * n + j0, 1, C + i * n + j0, 1, u);
+        break;
+    case ORDER_KIJ:
+        for (size_t k = k0; k < k1; ++k)
+            for (size_t i = i0; i < i1; ++i)
+                axpy(j1 - j0, A[i * n + k], B + k * n + j0, 1, C + i * n + j0, 1, u);
+        break;
+    case ORDER_JKI:
+        for (size_t j = j0; j < j1; ++j)
+            for (size_t k = k0; k < k1; ++k)
+                axpy(i1 - i0, B[k * n + j], A + i0 * n + k, n, C + i0 * n + j, n, u);
+        break;
+    case ORDER_KJI:
+        for (size_t k = k0; k < k1; ++k)
+            for (size_t j = j0; j < j1; ++j)
+                axpy(i1 - i0, B[k * n + j], A + i0 * n + k, n, C + i0 * n + j, n, u);
+        break;
+    }
+}
+
+void mult_run(const struct mult_config *cfg, size_t rows, size_t n,
+              const float *A, const float *B, float *C)
+{
+    int threads = cfg->threads > 0 ? cfg->threads : 1;
+    size_t T = cfg->tile ? cfg->tile : n;
+    // Без разбиения строки всё равно делятся между потоками поровну
+    size_t TI = cfg->tile ? cfg->tile : (rows + threads - 1) / threads;
+
+    memset(C, 0, rows * n * sizeof(float));
+
+    #pragma omp parallel for num_threads(threads) schedule(dynamic, 1)
+    for (size_t ii = 0; ii < rows; ii += TI)
+        for (size_t jj = 0; jj < n; jj += T)
+            for (size_t kk = 0; kk < n; kk += T)
+                mult_tile(cfg, n, A, B, C, ii, ii + TI < rows ? ii + TI : rows,
+                          jj, jj + T < n ? jj + T : n, kk, kk + T < n ? kk + T : n);
+}
+
+static double seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+// Время на одну строку C: полоса и вся матрица сравнимы между собой
+static double measure(const struct mult_config *cfg, size_t strip, size_t n,
+                      const float *A, const float *B, float *C)
+{
+    size_t rows = cfg->tile ? strip : n;
+    int repeats = rows < n ? TUNE_REPEATS : 1;
+    double best = 1e30;
+
+    for (int r = 0; r < repeats; ++r) {
+        double t0 = seconds();
+        mult_run(cfg, rows, n, A, B, C);
+        double t = seconds() - t0;
+        if (t < best) best = t;
+    }
+    return best / rows;
+}
+
+// Покоординатный спуск: порядок циклов, тайл, развёртка, потоки
+static void search(struct mult_config *best, size_t n)
+{
+    // Полоса кратна любому тайлу из списка
+    static const size_t tiles[] = { 16, 32, 64, 128, 0 };
+    static const int unrolls[] = { 1, 2, 4, 8 };
+    size_t rows = (size_t)TUNE_ROWS * best->threads;
+    if (rows > n) rows = n;
+    float *A = malloc(n * n * sizeof(float));
+    float *B = malloc(n * n * sizeof(float));
+    float *C = malloc(n * n * sizeof(float));
+
+    if (!A || !B || !C) {
+        free(A); free(B); free(C);
+        return;
+    }
+    for (size_t i = 0; i < n * n; ++i) {
+        A[i] = (float)(i % 7) - 3.0f;
+        B[i] = (float)(i % 5) - 2.0f;
+    }
+
+    // Порядок циклов выбирается с тайлами: на полосе
+    best->tile = 64;
+
+    double best_time = measure(best, rows, n, A, B, C);
+
+#define TRY(field, value)                                   \
+    do {                                                    \
+        struct mult_config c = *best;                       \
+        c.field = (value);                                  \
+        double t = measure(&c, rows, n, A, B, C);              \
+        if (t < best_time) { best_time = t; *best = c; }    \
+    } while (0)
+
+    for (int o = 0; o < ORDER_COUNT; ++o)
+        TRY(order, o);
+    for (size_t i = 0; i < sizeof(tiles) / sizeof(tiles[0]); ++i)
+        TRY(tile, tiles[i]);
+    for (size_t i = 0; i < sizeof(unrolls) / sizeof(unrolls[0]); ++i)
+        TRY(unroll, unrolls[i]);
+    for (int t = 1; !getenv("OMP_NUM_THREADS") && t < best->threads; t *= 2)
+        TRY(threads, t);
+
+#undef TRY
+
+    free(A); free(B); free(C);
+}
+
+int mult_autotune(struct mult_config *cfg, size_t n, int force)
+{
+    static const char *names[] = { "order", "tile", "unroll", "threads" };
+    struct tune_cache cache;
+    char keys[4][TUNE_KEY_SIZE];
+    long v[4];
+
+    // Лучшая форма зависит от размера: свои ключи на каждый n
+    for (int i = 0; i < 4; ++i)
+        snprintf(keys[i], TUNE_KEY_SIZE, "lab8.n%zu.%s", n, names[i]);
+
+    // Исходный вариант multMatrix: i-k-j без тайлов
+    cfg->order = ORDER_IKJ;
+    cfg->tile = 0;
+    cfg->unroll = 1;
+    cfg->threads = omp_get_max_threads();
+
+    tune_load(&cache);
+    int cached = 1;
+    for (int i = 0; i < 4; ++i)
+        cached = tune_get(&cache, keys[i], &v[i]) && cached;
+
+    if (cached && !force && v[0] >= 0 && v[0] < ORDER_COUNT && v[1] >= 0 &&
+        (v[2] == 1 || v[2] == 2 || v[2] == 4 || v[2] == 8) && v[3] > 0) {
+        cfg->order = (int)v[0];
+        cfg->tile = (size_t)v[1];
+        cfg->unroll = (int)v[2];
+        // Заданное пользователем OMP_NUM_THREADS важнее найденного
+        if (!getenv("OMP_NUM_THREADS"))
+            cfg->threads = (int)v[3];
+        return 0;
+    }
+
+    fprintf(stderr, "Tuning multMatrix for this machine...\n");
+    search(cfg, n);
+
+    tune_set(&cache, keys[0], cfg->order);
+    tune_set(&cache, keys[1], (long)cfg->tile);
+    tune_set(&cache, keys[2], cfg->unroll);
+    tune_set(&cache, keys[3], cfg->threads);
+    if (!tune_save(&cache))
+        fprintf(stderr, "Cannot write tuning cache %s\n", cache.path);
+    return 1;
+}
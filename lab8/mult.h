@@ -0,0 +1,28 @@
+#ifndef LAB8_MULT_H
+#define LAB8_MULT_H
+
+#include <stddef.h>
+
+// Порядок трёх циклов внутри тайла, от внешнего к внутреннему
+enum mult_order { ORDER_IJK, ORDER_IKJ, ORDER_JIK, ORDER_JKI, ORDER_KIJ, ORDER_KJI, ORDER_COUNT };
+
+struct mult_config {
+    int order;
+    size_t tile;        // сторона тайла; 0 — без разбиения
+    int unroll;         // развёртка внутреннего цикла: 1, 2, 4 или 8
+    int threads;
+};
+
+extern const char *const mult_order_names[ORDER_COUNT];
+
+// C = A * B в построчном хранении: A и C — rows x n, B — n x n.
+// Блоки строк C делятся между потоками, поэтому любой порядок циклов безопасен.
+void mult_run(const struct mult_config *cfg, size_t rows, size_t n,
+              const float *A, const float *B, float *C);
+
+// Конфигурация для умножения n x n из кэша настроек машины (common/tune.h);
+// если её там нет или force — подбор замерами и сохранение.
+// Возвращает 1, если был поиск.
+int mult_autotune(struct mult_config *cfg, size_t n, int force);
+
+#endif
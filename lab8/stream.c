@@ -0,0 +1,356 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "stream.h"
+#include "chase.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#else
+static int omp_get_thread_num(void) { return 0; }
+#endif
+
+#define STREAM_MIN_BYTES 4096
+#define STREAM_STEPS_PER_OCTAVE 2
+#define STREAM_MAX_POINTS 64
+#define STREAM_REPEATS 5
+// Один замер — не меньше стольких байт на поток: для кэшей ядро крутится
+// много раз между барьерами, иначе замеряется сам барьер
+#define STREAM_BYTES_PER_SAMPLE (8u << 20)
+#define STREAM_MAX_CPUS 1024
+#define STREAM_LEVELS 4
+
+const char *const stream_kernel_names[STREAM_KERNELS] = { "copy", "scale", "add", "triad" };
+
+static const char *const level_names[STREAM_LEVELS] = { "L1", "L2", "L3", "DRAM" };
+
+// Массивов в ядре, считая записываемый
+static const int kernel_arrays[STREAM_KERNELS] = { 2, 2, 3, 3 };
+
+static const double scalar = 3.0;
+
+// Ядра не встраиваются: иначе компилятор вправе слить повторы одного
+// и того же ядра подряд в один проход
+__attribute__((noinline))
+static void kernel_copy(double *restrict c, const double *restrict a, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        c[i] = a[i];
+}
+
+__attribute__((noinline))
+static void kernel_scale(double *restrict b, const double *restrict c, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        b[i] = scalar * c[i];
+}
+
+__attribute__((noinline))
+static void kernel_add(double *restrict c, const double *restrict a,
+                       const double *restrict b, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        c[i] = a[i] + b[i];
+}
+
+__attribute__((noinline))
+static void kernel_triad(double *restrict a, const double *restrict b,
+                         const double *restrict c, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        a[i] = b[i] + scalar * c[i];
+}
+
+#ifdef __SSE2__
+// Потоковая запись: массивы выровнены, n кратно восьми
+__attribute__((noinline))
+static void kernel_copy_nt(double *restrict c, const double *restrict a, size_t n)
+{
+    for (size_t i = 0; i < n; i += 2)
+        _mm_stream_pd(c + i, _mm_load_pd(a + i));
+    _mm_sfence();
+}
+
+__attribute__((noinline))
+static void kernel_scale_nt(double *restrict b, const double *restrict c, size_t n)
+{
+    __m128d s = _mm_set1_pd(scalar);
+    for (size_t i = 0; i < n; i += 2)
+        _mm_stream_pd(b + i, _mm_mul_pd(s, _mm_load_pd(c + i)));
+    _mm_sfence();
+}
+
+__attribute__((noinline))
+static void kernel_add_nt(double *restrict c, const double *restrict a,
+                          const double *restrict b, size_t n)
+{
+    for (size_t i = 0; i < n; i += 2)
+        _mm_stream_pd(c + i, _mm_add_pd(_mm_load_pd(a + i), _mm_load_pd(b + i)));
+    _mm_sfence();
+}
+
+__attribute__((noinline))
+static void kernel_triad_nt(double *restrict a, const double *restrict b,
+                            const double *restrict c, size_t n)
+{
+    __m128d s = _mm_set1_pd(scalar);
+    for (size_t i = 0; i < n; i += 2)
+        _mm_stream_pd(a + i, _mm_add_pd(_mm_load_pd(b + i), _mm_mul_pd(s, _mm_load_pd(c + i))));
+    _mm_sfence();
+}
+#define STREAM_STORES 2
+#else
+#define STREAM_STORES 1
+#endif
+
+static const char *const store_names[2] = { "regular", "nt" };
+
+static void run_kernel(int kernel, int nt, double *a, double *b, double *c, size_t n)
+{
+#ifdef __SSE2__
+    if (nt) {
+        switch (kernel) {
+        case STREAM_COPY:  kernel_copy_nt(c, a, n); break;
+        case STREAM_SCALE: kernel_scale_nt(b, c, n); break;
+        case STREAM_ADD:   kernel_add_nt(c, a, b, n); break;
+        case STREAM_TRIAD: kernel_triad_nt(a, b, c, n); break;
+        }
+        return;
+    }
+#else
+    (void)nt;
+#endif
+    switch (kernel) {
+    case STREAM_COPY:  kernel_copy(c, a, n); break;
+    case STREAM_SCALE: kernel_scale(b, c, n); break;
+    case STREAM_ADD:   kernel_add(c, a, b, n); break;
+    case STREAM_TRIAD: kernel_triad(a, b, c, n); break;
+    }
+}
+
+static double seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+int stream_cpus(int *cpus, int max)
+{
+    cpu_set_t set;
+    int count = 0;
+
+    if (sched_getaffinity(0, sizeof(set), &set) != 0)
+        return 0;
+    for (int i = 0; i < CPU_SETSIZE && count < max; ++i)
+        if (CPU_ISSET(i, &set))
+            cpus[count++] = i;
+    return count;
+}
+
+void stream_pin(int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    sched_setaffinity(0, sizeof(set), &set);
+}
+
+// Уровень, в который помещаются данные: L1 и L2 — свои у каждого ядра,
+// L3 общий, поэтому для него считается суммарный объём
+static int classify(size_t per_thread, size_t total, const size_t *caches)
+{
+    if (caches[0] && per_thread <= caches[0]) return 0;
+    if (caches[1] && per_thread <= caches[1]) return 1;
+    if (caches[2] && total <= caches[2]) return 2;
+    return 3;
+}
+
+// Лучшие за STREAM_REPEATS замеров ГБ/с всех ядер для threads потоков
+// с per_thread элементами каждого массива на поток
+static int measure(int threads, const int *cpus, int n_cpus, size_t per_thread,
+                   double gbs[STREAM_KERNELS][2])
+{
+    size_t total = 3 * per_thread * threads * sizeof(double);
+    double *base = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    double best[STREAM_KERNELS][2];
+    double t0 = 0;
+    size_t sample = per_thread * 3 * sizeof(double);
+    size_t inner = STREAM_BYTES_PER_SAMPLE / sample;
+
+    if (base == MAP_FAILED)
+        return 0;
+    if (inner < 1)
+        inner = 1;
+    for (int k = 0; k < STREAM_KERNELS; ++k)
+        best[k][0] = best[k][1] = 1e30;
+
+    #pragma omp parallel num_threads(threads)
+    {
+        int tid = omp_get_thread_num();
+        // Массивы разбиты на куски по потокам, а не потоки по массивам:
+        // кусок потока лежит подряд и трогается первым им самим (first touch),
+        // так что страницы оказываются на его узле NUMA
+        double *a = base + (size_t)tid * 3 * per_thread;
+        double *b = a + per_thread;
+        double *c = b + per_thread;
+
+        if (n_cpus > 0)
+            stream_pin(cpus[tid % n_cpus]);
+        for (size_t i = 0; i < per_thread; ++i) {
+            a[i] = 1.0;
+            b[i] = 2.0;
+            c[i] = 0.0;
+        }
+
+        for (int k = 0; k < STREAM_KERNELS; ++k)
+            for (int nt = 0; nt < STREAM_STORES; ++nt) {
+                // Прогрев: данные в кэше, страницы отображены
+                run_kernel(k, nt, a, b, c, per_thread);
+                for (int r = 0; r < STREAM_REPEATS; ++r) {
+                    // Начало отмечается до барьера: после него мастер может
+                    // получить процессор позже остальных потоков
+                    #pragma omp master
+                    t0 = seconds();
+                    #pragma omp barrier
+                    for (size_t i = 0; i < inner; ++i)
+                        run_kernel(k, nt, a, b, c, per_thread);
+                    #pragma omp barrier
+                    #pragma omp master
+                    {
+                        double t = seconds() - t0;
+                        if (t < best[k][nt]) best[k][nt] = t;
+                    }
+                }
+            }
+    }
+
+    for (int k = 0; k < STREAM_KERNELS; ++k)
+        for (int nt = 0; nt < 2; ++nt)
+            gbs[k][nt] = nt < STREAM_STORES
+                ? (double)kernel_arrays[k] * per_thread * sizeof(double) * inner * threads /
+                  best[k][nt] * 1e-9
+                : 0;
+
+    munmap(base, total);
+    return 1;
+}
+
+static void write_report(const struct stream_options *opt, const size_t *caches,
+                         double summary[][STREAM_LEVELS][STREAM_KERNELS][2])
+{
+    FILE *f = fopen(opt->report_path, "w");
+    if (!f) {
+        perror(opt->report_path);
+        return;
+    }
+
+    fprintf(f, "{\n  \"cache_bytes\": {\"L1\": %zu, \"L2\": %zu, \"L3\": %zu},\n",
+            caches[0], caches[1], caches[2]);
+    if (opt->peak_gflops > 0)
+        fprintf(f, "  \"peak_gflops\": %.3f,\n", opt->peak_gflops);
+    fprintf(f, "  \"bandwidth\": [");
+    for (size_t t = 0; t < opt->thread_counts; ++t) {
+        fprintf(f, "%s\n    {\"threads\": %d, \"levels\": {", t ? "," : "", opt->threads[t]);
+        int first = 1;
+        for (int l = 0; l < STREAM_LEVELS; ++l) {
+            if (summary[t][l][STREAM_TRIAD][0] == 0)
+                continue;
+            fprintf(f, "%s\n      \"%s\": {", first ? "" : ",", level_names[l]);
+            first = 0;
+            for (int k = 0; k < STREAM_KERNELS; ++k)
+                for (int nt = 0; nt < STREAM_STORES; ++nt)
+                    fprintf(f, "%s\"%s%s_gbs\": %.3f", k || nt ? ", " : "",
+                            stream_kernel_names[k], nt ? "_nt" : "", summary[t][l][k][nt]);
+            // Точка перегиба roofline: операционная интенсивность, с которой
+            // ядро упирается в вычисления, а не в этот уровень памяти
+            if (opt->peak_gflops > 0)
+                fprintf(f, ", \"ridge_flops_per_byte\": %.3f",
+                        opt->peak_gflops / summary[t][l][STREAM_TRIAD][0]);
+            fprintf(f, "}");
+        }
+        fprintf(f, "\n    }}");
+    }
+    fprintf(f, "\n  ]\n}\n");
+    fclose(f);
+}
+
+int stream_benchmark(const struct stream_options *opt)
+{
+    static int cpus[STREAM_MAX_CPUS];
+    int n_cpus = stream_cpus(cpus, STREAM_MAX_CPUS);
+    size_t caches[3] = { chase_sysfs_cache(1), chase_sysfs_cache(2), chase_sysfs_cache(3) };
+    double (*summary)[STREAM_LEVELS][STREAM_KERNELS][2] =
+        calloc(opt->thread_counts, sizeof(*summary));
+    FILE *csv = fopen(opt->csv_path, "w");
+
+    if (!summary || !csv) {
+        if (!csv) perror(opt->csv_path);
+        else fclose(csv);
+        free(summary);
+        return 1;
+    }
+    fprintf(csv, "Kernel,Stores,Threads,Bytes per thread,Total bytes,Level,GB/s\n");
+
+    for (size_t t = 0; t < opt->thread_counts; ++t) {
+        int threads = opt->threads[t];
+        double factor = pow(2.0, 1.0 / STREAM_STEPS_PER_OCTAVE);
+        size_t prev = 0;
+        int points = 0;
+
+        for (double s = STREAM_MIN_BYTES;
+             s * threads <= (double)opt->max_bytes && points < STREAM_MAX_POINTS; s *= factor) {
+            // Три массива, в каждом целое число блоков по 8 элементов
+            size_t per_thread = ((size_t)s / (3 * sizeof(double)) + 7) / 8 * 8;
+            size_t bytes = 3 * per_thread * sizeof(double);
+            double gbs[STREAM_KERNELS][2];
+
+            if (per_thread == prev)
+                continue;
+            prev = per_thread;
+            ++points;
+            if (!measure(threads, cpus, n_cpus, per_thread, gbs)) {
+                fprintf(stderr, "Memory allocation failed for %zu bytes\n", bytes * threads);
+                break;
+            }
+
+            int level = classify(bytes, bytes * threads, caches);
+            for (int k = 0; k < STREAM_KERNELS; ++k)
+                for (int nt = 0; nt < STREAM_STORES; ++nt) {
+                    fprintf(csv, "%s,%s,%d,%zu,%zu,%s,%.3f\n", stream_kernel_names[k],
+                            store_names[nt], threads, bytes, bytes * threads,
+                            level_names[level], gbs[k][nt]);
+                    if (gbs[k][nt] > summary[t][level][k][nt])
+                        summary[t][level][k][nt] = gbs[k][nt];
+                }
+            printf("%3d threads, %10zu B/thread (%-4s): copy %7.1f, scale %7.1f, add %7.1f, "
+                   "triad %7.1f GB/s; triad nt %7.1f GB/s\n", threads, bytes, level_names[level],
+                   gbs[STREAM_COPY][0], gbs[STREAM_SCALE][0], gbs[STREAM_ADD][0],
+                   gbs[STREAM_TRIAD][0], gbs[STREAM_TRIAD][1]);
+            fflush(stdout);
+        }
+    }
+    fclose(csv);
+
+    // Сводка для roofline: лучшая триада на каждом уровне
+    for (size_t t = 0; t < opt->thread_counts; ++t)
+        for (int l = 0; l < STREAM_LEVELS; ++l)
+            if (summary[t][l][STREAM_TRIAD][0] > 0)
+                printf("%3d threads, %-4s: triad %7.1f GB/s, triad nt %7.1f GB/s\n",
+                       opt->threads[t], level_names[l], summary[t][l][STREAM_TRIAD][0],
+                       summary[t][l][STREAM_TRIAD][1]);
+
+    write_report(opt, caches, summary);
+    free(summary);
+    return 0;
+}
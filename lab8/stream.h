@@ -0,0 +1,38 @@
+#ifndef LAB8_STREAM_H
+#define LAB8_STREAM_H
+
+#include <stddef.h>
+
+// Ядра STREAM (McCalpin) над массивами double:
+//   copy  c = a          (16 байт на элемент)
+//   scale b = s * c      (16)
+//   add   c = a + b      (24)
+//   triad a = b + s * c  (24)
+// Каждое — в двух вариантах записи: обычной и потоковой (non-temporal),
+// которая идёт мимо кэша и не читает строку перед записью. Байты считаются
+// по правилам STREAM, без чтения строки под запись.
+enum stream_kernel { STREAM_COPY, STREAM_SCALE, STREAM_ADD, STREAM_TRIAD, STREAM_KERNELS };
+
+extern const char *const stream_kernel_names[STREAM_KERNELS];
+
+struct stream_options {
+    size_t max_bytes;           // общий объём трёх массивов на самой большой точке
+    const int *threads;         // числа потоков для замера
+    size_t thread_counts;
+    double peak_gflops;         // пик процессора для точки перегиба roofline; 0 — нет
+    const char *csv_path;
+    const char *report_path;
+};
+
+// Полосы пропускания для каждого числа потоков и рабочих множеств на
+// поток от 4 КБ до max_bytes / threads; потоки закреплены за ядрами.
+// Возвращает 0 при успехе.
+int stream_benchmark(const struct stream_options *opt);
+
+// Процессоры, на которых процессу разрешено работать (не больше max);
+// возвращает их число
+int stream_cpus(int *cpus, int max);
+// Закрепить вызывающий поток за процессором cpu
+void stream_pin(int cpu);
+
+#endif
@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tlb.h"
+#include "../common/tune.h"
+
+#define TLB_MIN_PAGES 8
+#define TLB_STEPS_PER_OCTAVE 4
+#define TLB_MIN_HOPS (1 << 20)
+#define TLB_MAX_POINTS 256
+#define TLB_MAX_LEVELS 8
+
+struct tlb_point {
+    size_t pages;
+    double ns_small, ns_huge;       // обычные и огромные страницы
+    double cycles_small, cycles_huge;
+};
+
+// Плато добавки на трансляцию: сначала всё попадает в TLB, дальше —
+// обходы таблиц страниц, всё дороже по мере того, как сами таблицы
+// выпадают из кэшей
+struct tlb_level {
+    char name[24];
+    size_t pages;                   // охват: последнее число страниц на плато; 0 — без края
+    double walk_ns, data_ns;        // медианы по плато
+};
+
+// Добавка растёт с нуля, поэтому колено ищется не по отношению, как
+// у кэшей, а с порогом снизу: рост больше чем в TLB_KNEE_RATIO раз и
+// больше чем на TLB_KNEE_NS на двух точках подряд
+#define TLB_KNEE_RATIO 1.5
+#define TLB_KNEE_NS 1.0
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double median(const struct tlb_point *points, size_t from, size_t to, int walk)
+{
+    double v[TLB_MAX_POINTS];
+    size_t n = 0;
+    for (size_t i = from; i <= to; ++i)
+        v[n++] = walk ? points[i].ns_small - points[i].ns_huge : points[i].ns_huge;
+    qsort(v, n, sizeof(double), compare_double);
+    return n % 2 ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+}
+
+static size_t detect(const struct tlb_point *points, size_t count, struct tlb_level *levels,
+                     size_t max_levels)
+{
+    size_t n = 0, i = 0;
+    size_t first[TLB_MAX_LEVELS];
+
+#define W(k) (points[k].ns_small - points[k].ns_huge)
+#define ABOVE(k, level) (W(k) > (level) * TLB_KNEE_RATIO && W(k) > (level) + TLB_KNEE_NS)
+    while (i < count && n < max_levels) {
+        size_t start = i, end = i;
+        double level = W(i) > 0 ? W(i) : 0;
+
+        while (end + 1 < count &&
+               !(ABOVE(end + 1, level) && (end + 2 >= count || ABOVE(end + 2, level)))) {
+            ++end;
+            level = median(points, start, end, 1);
+            if (level < 0) level = 0;
+        }
+
+        // Шум виртуальной машины даёт ложные ступеньки: плато, почти
+        // не отличающееся от предыдущего, — его продолжение
+        double walk = median(points, start, end, 1);
+        if (n > 0 && !(walk > levels[n - 1].walk_ns * TLB_KNEE_RATIO &&
+                       walk > levels[n - 1].walk_ns + TLB_KNEE_NS)) {
+            start = first[--n];
+        }
+        first[n] = start;
+
+        struct tlb_level *l = &levels[n];
+        if (n == 0)
+            snprintf(l->name, sizeof(l->name), "TLB");
+        else
+            snprintf(l->name, sizeof(l->name), "walk %zu", n);
+        l->pages = end + 1 < count ? points[end].pages : 0;
+        l->walk_ns = median(points, start, end, 1);
+        l->data_ns = median(points, start, end, 0);
+        ++n;
+        i = end + 1;
+    }
+#undef ABOVE
+#undef W
+    return n;
+}
+
+// Нс на переход для каждого числа страниц на буфере с заданными страницами;
+// *huge_bytes — сколько буфера на самом деле отображено огромными
+static int sweep(size_t max_bytes, enum chase_pages pages, struct tlb_point *points,
+                 size_t count, int huge, size_t *huge_bytes)
+{
+    char *buffer = chase_alloc(max_bytes, pages);
+    if (!buffer)
+        return 0;
+
+    for (size_t i = 0; i < count; ++i) {
+        size_t n = points[i].pages;
+        size_t hops = n > TLB_MIN_HOPS ? n : TLB_MIN_HOPS;
+        double *ns = huge ? &points[i].ns_huge : &points[i].ns_small;
+        double *cycles = huge ? &points[i].cycles_huge : &points[i].cycles_small;
+
+        chase_build_pages(buffer, n, CHASE_PAGE, i + 1);
+        chase_run(buffer, n, NULL);
+        *ns = chase_run(buffer, hops, cycles);
+        if (i + 1 == count)
+            *huge_bytes = chase_huge_bytes();
+    }
+    chase_free(buffer, max_bytes);
+    return 1;
+}
+
+int tlb_benchmark(const struct tlb_options *opt)
+{
+    static size_t sizes[TLB_MAX_POINTS];
+    static struct tlb_point points[TLB_MAX_POINTS];
+    struct tlb_level levels[TLB_MAX_LEVELS];
+    size_t huge_bytes = 0, small_huge_bytes = 0;
+    enum chase_pages huge = opt->pages == CHASE_PAGES_HUGETLB ? CHASE_PAGES_HUGETLB
+                                                               : CHASE_PAGES_THP;
+    char host[256];
+    FILE *f;
+
+    size_t count = chase_sizes(TLB_MIN_PAGES * CHASE_PAGE, opt->max_bytes, CHASE_PAGE,
+                               TLB_STEPS_PER_OCTAVE, sizes, TLB_MAX_POINTS);
+    for (size_t i = 0; i < count; ++i)
+        points[i].pages = sizes[i] / CHASE_PAGE;
+
+    // Буферы по очереди: на многогигабайтных множествах два сразу не влезут
+    if (!sweep(opt->max_bytes, CHASE_PAGES_4K, points, count, 0, &small_huge_bytes) ||
+        !sweep(opt->max_bytes, huge, points, count, 1, &huge_bytes)) {
+        fprintf(stderr, "Cannot allocate %zu bytes%s\n", opt->max_bytes,
+                huge == CHASE_PAGES_HUGETLB ? " of hugetlb pages (see vm.nr_hugepages)" : "");
+        return 1;
+    }
+    if (small_huge_bytes > 0)
+        fprintf(stderr, "%zu bytes of the 4K buffer are backed by huge pages: "
+                        "the page-walk split is underestimated\n", small_huge_bytes);
+    if (huge_bytes < opt->max_bytes / 2)
+        fprintf(stderr, "Only %zu of %zu bytes are backed by huge pages: "
+                        "the page-walk split is underestimated\n", huge_bytes, opt->max_bytes);
+
+    for (size_t i = 0; i < count; ++i)
+        printf("%9zu pages (%11zu B): 4K %7.2f ns, huge %7.2f ns, walk %7.2f ns\n",
+               points[i].pages, points[i].pages * CHASE_PAGE, points[i].ns_small,
+               points[i].ns_huge, points[i].ns_small - points[i].ns_huge);
+
+    size_t n_levels = detect(points, count, levels, TLB_MAX_LEVELS);
+    for (size_t i = 0; i < n_levels; ++i) {
+        if (levels[i].pages)
+            printf("%-9s up to %9zu pages: walk %7.2f ns + data %7.2f ns\n", levels[i].name,
+                   levels[i].pages, levels[i].walk_ns, levels[i].data_ns);
+        else
+            printf("%-9s                  : walk %7.2f ns + data %7.2f ns\n", levels[i].name,
+                   levels[i].walk_ns, levels[i].data_ns);
+    }
+
+    if ((f = fopen(opt->csv_path, "w")) != NULL) {
+        fprintf(f, "Pages,Bytes,4K ns,Huge ns,Walk ns,4K cycles,Huge cycles\n");
+        for (size_t i = 0; i < count; ++i)
+            fprintf(f, "%zu,%zu,%.3f,%.3f,%.3f,%.3f,%.3f\n", points[i].pages,
+                    points[i].pages * CHASE_PAGE, points[i].ns_small, points[i].ns_huge,
+                    points[i].ns_small - points[i].ns_huge, points[i].cycles_small,
+                    points[i].cycles_huge);
+        fclose(f);
+    } else {
+        perror(opt->csv_path);
+    }
+
+    if ((f = fopen(opt->report_path, "w")) == NULL) {
+        perror(opt->report_path);
+        return 1;
+    }
+    tune_host(host, sizeof(host));
+    fprintf(f, "{\n  \"host\": \"%s\",\n  \"max_bytes\": %zu,\n  \"pages\": \"%s\",\n"
+               "  \"huge_pages\": \"%s\",\n  \"huge_backed_bytes\": %zu,\n"
+               "  \"small_huge_backed_bytes\": %zu,\n  \"levels\": [",
+            host, opt->max_bytes, chase_pages_names[opt->pages], chase_pages_names[huge],
+            huge_bytes, small_huge_bytes);
+    for (size_t i = 0; i < n_levels; ++i)
+        fprintf(f, "%s\n    {\"name\": \"%s\", \"reach_pages\": %zu, \"reach_bytes\": %zu, "
+                   "\"walk_ns\": %.3f, \"data_ns\": %.3f}",
+                i ? "," : "", levels[i].name, levels[i].pages, levels[i].pages * CHASE_PAGE,
+                levels[i].walk_ns, levels[i].data_ns);
+    fprintf(f, "\n  ],\n  \"points\": [");
+    for (size_t i = 0; i < count; ++i)
+        fprintf(f, "%s\n    {\"pages\": %zu, \"small_ns\": %.3f, \"huge_ns\": %.3f, "
+                   "\"walk_ns\": %.3f, \"data_ns\": %.3f}",
+                i ? "," : "", points[i].pages, points[i].ns_small, points[i].ns_huge,
+                points[i].ns_small - points[i].ns_huge, points[i].ns_huge);
+    fprintf(f, "\n  ]\n}\n");
+    fclose(f);
+    return 0;
+}
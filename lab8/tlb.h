@@ -0,0 +1,24 @@
+#ifndef LAB8_TLB_H
+#define LAB8_TLB_H
+
+#include <stddef.h>
+
+#include "chase.h"
+
+// Охват TLB: случайный обход по узлу на страницу для числа страниц от
+// нескольких до max_bytes / 4 КБ. Та же раскладка проходится на обычных
+// и на огромных страницах (huge): данные и промахи кэша одинаковы,
+// поэтому разность — цена промахов TLB и обхода таблиц страниц.
+struct tlb_options {
+    size_t max_bytes;
+    // Режим из --pages: при hugetlb огромные страницы берутся из пула,
+    // при остальных — прозрачные (thp)
+    enum chase_pages pages;
+    const char *csv_path;
+    const char *report_path;
+};
+
+// Возвращает 0 при успехе
+int tlb_benchmark(const struct tlb_options *opt);
+
+#endif